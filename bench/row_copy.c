@@ -0,0 +1,141 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "image.h"
+#include "row_copy.h"
+
+/*
+ * compares the row copy kernels against a single memcpy of the whole plane on
+ * every plane geometry of the supported formats. destination rows are padded
+ * like the row pitch of a linear image or a staging buffer usually is, the
+ * memcpy ignores the padding and shows what a packed copy would reach.
+ */
+
+#define DST_PITCH_ALIGNMENT 256
+#define ITERATIONS 20
+
+static const struct {
+	const char *name;
+	enum image_format format;
+} formats[] = {
+	{ "yu12", IMAGE_FORMAT_YU12 },
+	{ "nv12", IMAGE_FORMAT_NV12 },
+	{ "422p", IMAGE_FORMAT_422P },
+};
+
+static const struct {
+	uint32_t width;
+	uint32_t height;
+} resolutions[] = {
+	{ 1920, 1080 },
+	{ 3840, 2160 },
+	{ 7680, 4320 },
+};
+
+static uint64_t
+now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/* the baseline, the rows copied as if dst was as tightly packed as src */
+static void
+memcpy_packed(void *dst, size_t dst_pitch,
+		const void *src, size_t src_pitch, size_t width, size_t rows) {
+	memcpy(dst, src, src_pitch * rows);
+}
+
+/* best of ITERATIONS runs, in GB/s */
+static double
+measure(row_copy_fn fn, uint8_t *dst, size_t dst_pitch,
+		const uint8_t *src, size_t width, size_t rows) {
+	uint64_t best = UINT64_MAX;
+	for (int i = 0; i < ITERATIONS; i++) {
+		uint64_t start = now_ns();
+		fn(dst, dst_pitch, src, width, width, rows);
+		uint64_t elapsed = now_ns() - start;
+		if (elapsed < best) {
+			best = elapsed;
+		}
+	}
+	return (double) width * rows / (best > 0 ? best : 1);
+}
+
+static int
+verify(const uint8_t *dst, size_t dst_pitch,
+		const uint8_t *src, size_t width, size_t rows) {
+	for (size_t row = 0; row < rows; row++) {
+		if (memcmp(dst + row * dst_pitch, src + row * width, width) != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int main(void) {
+	printf("%-6s %-10s %-5s %-10s %10s", "format", "resolution", "plane",
+			"geometry", "memcpy");
+	for (int kernel = 0; kernel < ROW_COPY_KERNEL_COUNT; kernel++) {
+		printf(" %10s", row_copy_kernel_name(kernel));
+	}
+	printf("   (GB/s, best kernel %s)\n",
+			row_copy_kernel_name(row_copy_best_kernel()));
+
+	for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+		for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++) {
+			uint32_t plane_count = image_format_plane_count(formats[f].format);
+			for (uint32_t plane = 0; plane < plane_count; plane++) {
+				uint32_t width, height;
+				image_format_plane_size(formats[f].format,
+						resolutions[r].width, resolutions[r].height,
+						&width, &height, plane);
+				size_t dst_pitch = (width + DST_PITCH_ALIGNMENT - 1)
+					/ DST_PITCH_ALIGNMENT * DST_PITCH_ALIGNMENT;
+
+				uint8_t *src = malloc((size_t) width * height);
+				uint8_t *dst = aligned_alloc(DST_PITCH_ALIGNMENT,
+						dst_pitch * height);
+				for (size_t i = 0; i < (size_t) width * height; i++) {
+					src[i] = i * 31 + 7;
+				}
+				memset(dst, 0, dst_pitch * height);
+
+				char resolution[16], geometry[16];
+				snprintf(resolution, sizeof(resolution), "%ux%u",
+						resolutions[r].width, resolutions[r].height);
+				snprintf(geometry, sizeof(geometry), "%ux%u", width, height);
+				printf("%-6s %-10s %-5u %-10s %10.2f", formats[f].name,
+						resolution, plane, geometry,
+						measure(memcpy_packed, dst, dst_pitch, src, width, height));
+
+				for (int kernel = 0; kernel < ROW_COPY_KERNEL_COUNT; kernel++) {
+					row_copy_fn fn = row_copy_get_kernel(kernel);
+					if (fn == NULL) {
+						printf(" %10s", "-");
+						continue;
+					}
+
+					memset(dst, 0, dst_pitch * height);
+					double bandwidth = measure(fn, dst, dst_pitch, src,
+							width, height);
+					if (verify(dst, dst_pitch, src, width, height) == -1) {
+						fprintf(stderr, "%s kernel produced a wrong copy\n",
+								row_copy_kernel_name(kernel));
+						return EXIT_FAILURE;
+					}
+					printf(" %10.2f", bandwidth);
+				}
+				printf("\n");
+
+				free(dst);
+				free(src);
+			}
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,250 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "image.h"
+#include "vulkan.h"
+
+/*
+ * measures the cpu side of linear uploads without a render pass or a
+ * swapchain. frames are written into linear host-visible images, with and
+ * without disjoint planes, and into host-visible memory with row pitches
+ * padded to several alignments.
+ */
+
+#define ITERATIONS 20
+
+static const struct {
+	const char *name;
+	enum image_format format;
+} formats[] = {
+	{ "yu12", IMAGE_FORMAT_YU12 },
+	{ "nv12", IMAGE_FORMAT_NV12 },
+	{ "422p", IMAGE_FORMAT_422P },
+};
+
+static const struct {
+	uint32_t width;
+	uint32_t height;
+} resolutions[] = {
+	{ 1920, 1080 },
+	{ 3840, 2160 },
+	{ 7680, 4320 },
+};
+
+/* 1 packs rows tightly, the others pad them like drivers tend to */
+static const VkDeviceSize pitch_alignments[] = { 1, 64, 256, 4096 };
+
+static uint64_t
+now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/* best of ITERATIONS runs, in GB/s */
+static double
+measure(struct worker_pool *workers, const struct image_plane_copy *planes,
+		uint32_t plane_count) {
+	size_t bytes = 0;
+	for (uint32_t plane = 0; plane < plane_count; plane++) {
+		bytes += (size_t) planes[plane].width * planes[plane].height;
+	}
+
+	uint64_t best = UINT64_MAX;
+	for (int i = 0; i < ITERATIONS; i++) {
+		uint64_t start = now_ns();
+		image_copy_to_memory(workers, planes, plane_count);
+		uint64_t elapsed = now_ns() - start;
+		if (elapsed < best) {
+			best = elapsed;
+		}
+	}
+	return (double) bytes / (best > 0 ? best : 1);
+}
+
+static void
+print_row(const char *format, const char *resolution, const char *destination,
+		VkDeviceSize pitch, double init_ms, struct worker_pool *workers,
+		const struct image_plane_copy *planes, uint32_t plane_count) {
+	printf("%-6s %-10s %-14s %6" PRIu64, format, resolution, destination,
+			(uint64_t) pitch);
+	if (init_ms >= 0.0) {
+		printf(" %8.3f", init_ms);
+	} else {
+		printf(" %8s", "-");
+	}
+	for (uint32_t plane = 0; plane < 3; plane++) {
+		if (plane < plane_count) {
+			printf(" %8.2f", measure(workers, &planes[plane], 1));
+		} else {
+			printf(" %8s", "-");
+		}
+	}
+	printf(" %8.2f\n", measure(workers, planes, plane_count));
+}
+
+static void
+bench_image(struct vulkan_ctx *vk, struct image_uploader *uploader,
+		const char *format_name, const char *resolution, enum image_format format,
+		uint32_t width, uint32_t height, bool disjoint, const uint8_t *src) {
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(vk->physical_device,
+			image_format_to_vk_format(format), &properties);
+	if (disjoint && !(properties.linearTilingFeatures & VK_FORMAT_FEATURE_DISJOINT_BIT)) {
+		printf("%-6s %-10s %-14s not supported\n", format_name, resolution,
+				"image-disjoint");
+		return;
+	}
+
+	struct image image;
+	uint64_t start = now_ns();
+	VkResult res = image_init_from_memory(&image, vk, uploader, src,
+			width, height, format, disjoint, IMAGE_CONVERSION_SAMPLER);
+	double init_ms = (now_ns() - start) / 1e6;
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "bench_image - image_init_from_memory failed (%d)\n", res);
+		return;
+	}
+
+	struct image_plane_copy planes[3];
+	size_t src_offset = 0;
+	for (uint32_t plane = 0; plane < image.plane_count; plane++) {
+		uint32_t plane_width, plane_height;
+		image_format_plane_size(format, width, height,
+				&plane_width, &plane_height, plane);
+		planes[plane] = (struct image_plane_copy) {
+			.dst = image.allocations[disjoint ? plane : 0].mapped_ptr,
+			.layout = image.plane_layouts[plane],
+			.width = plane_width,
+			.height = plane_height,
+			.data = src + src_offset,
+		};
+		src_offset += (size_t) plane_width * plane_height;
+	}
+
+	print_row(format_name, resolution, disjoint ? "image-disjoint" : "image",
+			image.plane_layouts[0].rowPitch, init_ms, &uploader->workers,
+			planes, image.plane_count);
+	image_finish(&image, vk);
+}
+
+static void
+bench_pitch(struct vulkan_ctx *vk, struct worker_pool *workers,
+		const char *format_name, const char *resolution, enum image_format format,
+		uint32_t width, uint32_t height, VkDeviceSize alignment, const uint8_t *src) {
+	struct image_plane_copy planes[3];
+	uint32_t plane_count = image_format_plane_count(format);
+	VkDeviceSize size = 0;
+	size_t src_offset = 0;
+	for (uint32_t plane = 0; plane < plane_count; plane++) {
+		uint32_t plane_width, plane_height;
+		image_format_plane_size(format, width, height,
+				&plane_width, &plane_height, plane);
+		VkDeviceSize pitch = (plane_width + alignment - 1) / alignment * alignment;
+		planes[plane] = (struct image_plane_copy) {
+			.layout = {
+				.offset = size,
+				.size = pitch * plane_height,
+				.rowPitch = pitch,
+			},
+			.width = plane_width,
+			.height = plane_height,
+			.data = src + src_offset,
+		};
+		size += (pitch * plane_height + alignment - 1) / alignment * alignment;
+		src_offset += (size_t) plane_width * plane_height;
+	}
+
+	VkMemoryRequirements requirements = {
+		.size = size,
+		.alignment = alignment > 256 ? alignment : 256,
+		.memoryTypeBits = 1u << vk->host_visible_memory_index,
+	};
+	struct memory_allocation allocation;
+	VkResult res = memory_allocator_alloc(&vk->allocator, &requirements,
+			vk->host_visible_memory_index, true, &allocation);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "bench_pitch - memory_allocator_alloc failed (%d)\n", res);
+		return;
+	}
+	for (uint32_t plane = 0; plane < plane_count; plane++) {
+		planes[plane].dst = allocation.mapped_ptr;
+	}
+
+	char destination[16];
+	snprintf(destination, sizeof(destination), "align-%" PRIu64,
+			(uint64_t) alignment);
+	print_row(format_name, resolution, destination, planes[0].layout.rowPitch,
+			-1.0, workers, planes, plane_count);
+	memory_allocator_free(&vk->allocator, &allocation);
+}
+
+int main(int argc, char *argv[]) {
+	uint32_t nworkers = 1;
+	int opt;
+	while ((opt = getopt(argc, argv, "j:")) != -1) {
+		switch (opt) {
+			case 'j':
+				nworkers = atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-j workers]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	struct vulkan_ctx_features features = {
+		.headless = true,
+		.enable_ycbcr_conversion = true,
+		.enable_timeline_semaphore = true,
+	};
+	struct vulkan_ctx *vk = vulkan_ctx_create(&features);
+
+	struct image_uploader uploader;
+	VkResult res = image_uploader_init(&uploader, vk, IMAGE_UPLOAD_MODE_LINEAR,
+			0, nworkers);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "image_uploader_init failed (%d)\n", res);
+		return EXIT_FAILURE;
+	}
+
+	printf("%-6s %-10s %-14s %6s %8s %8s %8s %8s %8s"
+			"   (GB/s, %u copy workers)\n", "format", "resolution", "destination",
+			"pitch", "init ms", "plane 0", "plane 1", "plane 2", "frame",
+			uploader.workers.nworkers);
+
+	for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+		for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++) {
+			enum image_format format = formats[f].format;
+			uint32_t width = resolutions[r].width;
+			uint32_t height = resolutions[r].height;
+
+			size_t size = image_format_size(format, width, height);
+			uint8_t *src = malloc(size);
+			for (size_t i = 0; i < size; i++) {
+				src[i] = i * 31 + 7;
+			}
+
+			char resolution[16];
+			snprintf(resolution, sizeof(resolution), "%ux%u", width, height);
+			for (int disjoint = 0; disjoint < 2; disjoint++) {
+				bench_image(vk, &uploader, formats[f].name, resolution, format,
+						width, height, disjoint, src);
+			}
+			for (size_t a = 0; a < sizeof(pitch_alignments) / sizeof(pitch_alignments[0]); a++) {
+				bench_pitch(vk, &uploader.workers, formats[f].name, resolution,
+						format, width, height, pitch_alignments[a], src);
+			}
+
+			free(src);
+		}
+	}
+
+	image_uploader_finish(&uploader, vk);
+	vulkan_ctx_destroy(vk);
+	return EXIT_SUCCESS;
+}
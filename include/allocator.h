@@ -0,0 +1,67 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+
+#define MEMORY_ALLOCATOR_BLOCK_SIZE (128ull * 1024 * 1024)
+
+struct memory_block;
+struct memory_chunk;
+
+struct memory_allocation {
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	/* NULL unless the memory type is host visible */
+	void *mapped_ptr;
+
+	struct memory_block *block;
+	struct memory_chunk *chunk;
+};
+
+/* blocks of a single memory type, each carved into a list of chunks */
+struct memory_pool {
+	uint32_t memory_index;
+	struct memory_block *blocks;
+};
+
+struct memory_allocator {
+	VkDevice device;
+	const VkPhysicalDeviceMemoryProperties *memory_properties;
+	VkDeviceSize block_size;
+	/* linear and optimal resources can't share a page of this size */
+	VkDeviceSize buffer_image_granularity;
+
+	/* startup allocates from several threads at once */
+	pthread_mutex_t lock;
+	struct memory_pool pools[VK_MAX_MEMORY_TYPES];
+};
+
+struct memory_stats {
+	uint32_t block_count;
+	uint32_t allocation_count;
+	uint32_t free_chunk_count;
+	VkDeviceSize block_bytes;
+	VkDeviceSize used_bytes;
+	VkDeviceSize largest_free_chunk;
+};
+
+void memory_allocator_init(struct memory_allocator *ini, VkDevice device,
+		const VkPhysicalDeviceMemoryProperties *memory_properties,
+		VkDeviceSize buffer_image_granularity);
+void memory_allocator_finish(struct memory_allocator *allocator);
+
+/* linear is true for buffers and linear images, false for optimal images */
+VkResult memory_allocator_alloc(struct memory_allocator *allocator,
+		const VkMemoryRequirements *requirements, uint32_t memory_index,
+		bool linear, struct memory_allocation *allocation);
+void memory_allocator_free(struct memory_allocator *allocator,
+		struct memory_allocation *allocation);
+
+void memory_allocator_get_stats(struct memory_allocator *allocator,
+		uint32_t memory_index, struct memory_stats *stats);
+void memory_allocator_print_stats(struct memory_allocator *allocator);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vulkan.h"
+
+/* the p99 is taken over this many of the latest samples */
+#define GPU_TIMER_SAMPLES 1024
+
+enum gpu_stage {
+	GPU_STAGE_UPLOAD_COPY,
+	/*
+	 * from the acquired swapchain image to the end of the recorded commands,
+	 * so compute conversion and the horizontal scaling pass are included
+	 */
+	GPU_STAGE_DRAW,
+	GPU_STAGE_FRAME,
+	GPU_STAGE_COUNT,
+};
+
+struct gpu_stage_stats {
+	uint64_t count;
+	double total_ns;
+	double min_ns;
+	double max_ns;
+	double samples[GPU_TIMER_SAMPLES];
+};
+
+/* where the timers of the frames and the uploads report to */
+struct gpu_timings {
+	struct gpu_stage_stats stages[GPU_STAGE_COUNT];
+};
+
+/*
+ * a query pool per set, e.g. per frame in flight, with a begin and an end
+ * timestamp per stage. a set is only read once the submission that wrote it
+ * is known to be done, so reading results never stalls.
+ */
+struct gpu_timer {
+	struct gpu_timings *timings;
+
+	uint32_t nsets;
+	VkQueryPool *pools;
+	/* per set, the stages written since its last reset */
+	uint32_t *written;
+
+	double period_ns;
+	uint64_t valid_mask;
+};
+
+void gpu_timings_init(struct gpu_timings *ini);
+void gpu_timings_print(const struct gpu_timings *timings);
+
+/* leaves timer disabled if the queue doesn't support timestamps */
+VkResult gpu_timer_init(struct gpu_timer *ini, struct vulkan_ctx *vk,
+		struct gpu_timings *timings, uint32_t nsets);
+void gpu_timer_finish(struct gpu_timer *timer, struct vulkan_ctx *vk);
+bool gpu_timer_enabled(const struct gpu_timer *timer);
+
+/*
+ * reports the results of the previous use of set, then records its reset
+ * into cmd. only call once that use has completed on the gpu.
+ */
+void gpu_timer_reset(struct gpu_timer *timer, struct vulkan_ctx *vk,
+		VkCommandBuffer cmd, uint32_t set);
+void gpu_timer_begin(struct gpu_timer *timer, VkCommandBuffer cmd,
+		uint32_t set, enum gpu_stage stage, VkPipelineStageFlagBits pipeline_stage);
+void gpu_timer_end(struct gpu_timer *timer, VkCommandBuffer cmd,
+		uint32_t set, enum gpu_stage stage, VkPipelineStageFlagBits pipeline_stage);
+/* reports the results of every set, only call once the device is idle */
+void gpu_timer_collect_all(struct gpu_timer *timer, struct vulkan_ctx *vk);
+
+#endif
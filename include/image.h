@@ -1,7 +1,10 @@
 #ifndef IMAGE_H
 #define IMAGE_H
 
+#include "gpu_timer.h"
+#include "staging.h"
 #include "vulkan.h"
+#include "worker_pool.h"
 
 enum image_format {
 	IMAGE_FORMAT_YU12,
@@ -72,32 +75,191 @@ image_format_plane_size(enum image_format format,
 	}
 }
 
+/* bytes per texel of a plane, the width from image_format_plane_size is in bytes */
+static inline uint32_t
+image_format_plane_texel_size(enum image_format format, uint32_t plane) {
+	if (format == IMAGE_FORMAT_NV12 && plane == 1) {
+		return 2;
+	}
+	return 1;
+}
+
+/* format of a view of a single plane */
+static inline VkFormat
+image_format_plane_vk_format(enum image_format format, uint32_t plane) {
+	return image_format_plane_texel_size(format, plane) == 2
+		? VK_FORMAT_R8G8_UNORM : VK_FORMAT_R8_UNORM;
+}
+
+enum image_color_model {
+	IMAGE_COLOR_MODEL_BT601,
+	IMAGE_COLOR_MODEL_BT709,
+	IMAGE_COLOR_MODEL_BT2020,
+};
+
+enum image_color_range {
+	/* codes use all of 0-255 */
+	IMAGE_COLOR_RANGE_FULL,
+	/* luma is 16-235 and chroma 16-240 */
+	IMAGE_COLOR_RANGE_LIMITED,
+};
+
+/* how frames are converted to rgb */
+enum image_conversion {
+	/* sampled through a VkSamplerYcbcrConversion */
+	IMAGE_CONVERSION_SAMPLER,
+	/* the planes are read on their own by a compute shader writing rgba */
+	IMAGE_CONVERSION_COMPUTE,
+};
+
+enum image_upload_mode {
+	/* linear host-visible image written directly by the cpu */
+	IMAGE_UPLOAD_MODE_LINEAR,
+	/* staging buffer copied into an optimal device-local image */
+	IMAGE_UPLOAD_MODE_STAGING,
+};
+
+#define IMAGE_UPLOADER_MAX_INFLIGHT 4
+
+/* cpu time spent in image_upload, from the first row copied to the submit */
+struct image_upload_stats {
+	uint64_t count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	/* uploads copied by the gpu straight out of imported host memory */
+	uint64_t zero_copy;
+	/*
+	 * part of total_ns staging uploads spent blocked on earlier copies, for
+	 * a free command buffer or staging space. uploads are never waited on
+	 * otherwise, so the rest is cpu work.
+	 */
+	uint64_t wait_ns;
+};
+
+/* host memory wrapped in a buffer through VK_EXT_external_memory_host */
+struct image_host_import {
+	const uint8_t *ptr;
+	VkDeviceSize size;
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+};
+
+struct image_uploader {
+	enum image_upload_mode mode;
+
+	/* copies the rows of all planes of a frame in bands */
+	struct worker_pool workers;
+	struct image_upload_stats stats;
+
+	/* only used by IMAGE_UPLOAD_MODE_STAGING */
+	struct staging_ring ring;
+	VkDeviceSize offset_alignment;
+	VkDeviceSize row_pitch_alignment;
+	/* frames inside this range skip the staging ring */
+	struct image_host_import host_import;
+
+	/* signalled with an increasing value by every upload submission */
+	VkSemaphore timeline;
+	uint64_t submitted;
+
+	VkCommandPool cmd_pool;
+	VkCommandBuffer cmds[IMAGE_UPLOADER_MAX_INFLIGHT];
+	uint64_t cmd_values[IMAGE_UPLOADER_MAX_INFLIGHT];
+	uint32_t next_cmd;
+
+	/* a set of timestamps per command buffer, disabled unless asked for */
+	struct gpu_timer timer;
+};
+
+VkResult image_uploader_init(struct image_uploader *ini, struct vulkan_ctx *vk,
+		enum image_upload_mode mode, VkDeviceSize staging_size,
+		uint32_t nworkers);
+void image_uploader_finish(struct image_uploader *uploader,
+		struct vulkan_ctx *vk);
+/*
+ * lets staging uploads of frames inside [ptr, ptr + size) copy on the gpu
+ * without touching the data on the cpu. only the part aligned to
+ * minImportedHostPointerAlignment and within maxMemoryAllocationSize is
+ * imported. the memory has to stay mapped until image_uploader_release_host,
+ * which waits for all uploads from it.
+ */
+VkResult image_uploader_import_host(struct image_uploader *uploader,
+		struct vulkan_ctx *vk, const void *ptr, size_t size);
+void image_uploader_release_host(struct image_uploader *uploader,
+		struct vulkan_ctx *vk);
+/* times the copies and layout transitions of staging uploads into timings */
+VkResult image_uploader_enable_timing(struct image_uploader *uploader,
+		struct vulkan_ctx *vk, struct gpu_timings *timings);
+
 struct image {
 	uint32_t width;
 	uint32_t height;
 
 	enum image_format format;
 	uint32_t plane_count;
+	bool disjoint;
+	VkImageTiling tiling;
+	VkImageLayout layout;
 	VkImage vk_image;
-	VkDeviceMemory vk_memories[3];
+
+	/* one memory per plane if disjoint, otherwise a single memory */
+	uint32_t memory_count;
+	struct memory_allocation allocations[3];
+
+	/* plane layouts of linear images */
+	VkSubresourceLayout plane_layouts[3];
 };
 
+/* y4m files bring their own geometry, width, height and format are for raw ones */
 VkResult image_init_from_file(struct image *ini, struct vulkan_ctx *vk,
-		const char *file, uint32_t width, uint32_t height,
-		enum image_format format, bool disjoint);
+		struct image_uploader *uploader, const char *file,
+		uint32_t width, uint32_t height, enum image_format format,
+		bool disjoint, enum image_conversion conversion);
+/* conversion decides whether the planes can also be viewed on their own */
 VkResult image_init_from_memory(struct image *ini, struct vulkan_ctx *vk,
-		void *mem, uint32_t width, uint32_t height,
-		enum image_format format, bool disjoint);
+		struct image_uploader *uploader, const void *mem,
+		uint32_t width, uint32_t height, enum image_format format,
+		bool disjoint, enum image_conversion conversion);
+VkResult image_upload(struct image *image, struct vulkan_ctx *vk,
+		struct image_uploader *uploader, const void *mem);
 void image_finish(struct image *image, struct vulkan_ctx *vk);
 
+/* a tightly packed plane at data, written to dst + layout.offset */
+struct image_plane_copy {
+	void *dst;
+	VkSubresourceLayout layout;
+	uint32_t width;
+	uint32_t height;
+	const void *data;
+};
+
+/*
+ * splits every plane into up to one band of rows per worker and copies all
+ * bands of all planes as a single batch, so planes are copied concurrently.
+ */
+void image_copy_to_memory(struct worker_pool *workers,
+		const struct image_plane_copy *planes, uint32_t plane_count);
+
 struct image_sampler {
 	enum image_format format;
+	enum image_conversion mode;
+	enum image_color_model model;
+	enum image_color_range range;
+	/* VK_NULL_HANDLE for IMAGE_CONVERSION_COMPUTE, sampler is a plain one */
 	VkSamplerYcbcrConversion conversion;
 	VkSampler sampler;
 };
 
+/*
+ * filter applies to luma and chroma alike, a linear one needs
+ * VK_FORMAT_FEATURE_SAMPLED_IMAGE_YCBCR_CONVERSION_LINEAR_FILTER_BIT with the
+ * sampler conversion. the compute conversion fetches texels unfiltered and
+ * only filters the rgba image.
+ */
 VkResult image_sampler_init(struct image_sampler *ini, struct vulkan_ctx *vk,
-		enum image_format format);
+		enum image_format format, enum image_conversion mode,
+		enum image_color_model model, enum image_color_range range,
+		VkFilter filter);
 void image_sampler_finish(struct image_sampler *sampler, struct vulkan_ctx *vk);
 
 #endif
@@ -0,0 +1,66 @@
+#ifndef IMAGE_POOL_H
+#define IMAGE_POOL_H
+
+#include "image.h"
+
+#define IMAGE_POOL_DEFAULT_IDLE_BUDGET (256ull * 1024 * 1024)
+
+struct image_pool_key {
+	enum image_format format;
+	uint32_t width;
+	uint32_t height;
+	bool disjoint;
+};
+
+/*
+ * an image with its memory and views ready for sampling, either one through
+ * the ycbcr conversion or one per plane, as the sampler converts
+ */
+struct pooled_image {
+	struct image_pool_key key;
+	struct image image;
+	VkImageView view;
+	VkImageView plane_views[3];
+	VkDeviceSize size;
+
+	bool in_use;
+	/* pool tick of the last release, the smallest is evicted first */
+	uint64_t released_at;
+};
+
+struct image_pool_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+};
+
+/*
+ * hands out images by format, extent and disjointness and keeps released
+ * ones for reuse. idle images beyond idle_budget bytes are destroyed least
+ * recently released first.
+ */
+struct image_pool {
+	VkDeviceSize idle_budget;
+	VkDeviceSize idle_bytes;
+	uint64_t tick;
+
+	uint32_t count;
+	uint32_t capacity;
+	struct pooled_image **images;
+
+	struct image_pool_stats stats;
+};
+
+void image_pool_init(struct image_pool *ini, VkDeviceSize idle_budget);
+void image_pool_finish(struct image_pool *pool, struct vulkan_ctx *vk);
+
+/* returns an image holding mem, the sampler has to match format */
+VkResult image_pool_acquire(struct image_pool *pool, struct vulkan_ctx *vk,
+		struct image_uploader *uploader, const struct image_sampler *sampler,
+		const void *mem, uint32_t width, uint32_t height,
+		enum image_format format, bool disjoint, struct pooled_image **out);
+/* only release images no pending submission references anymore */
+void image_pool_release(struct image_pool *pool, struct vulkan_ctx *vk,
+		struct pooled_image *image);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PACER_MAX_PENDING 16
+
+enum pacer_mode {
+	/* frames are started so that they are submitted by the time they are due */
+	PACER_MODE_CONTENT,
+	/* frames are started so that they make the first refresh after they are due */
+	PACER_MODE_DISPLAY,
+};
+
+struct pacer_stats {
+	uint64_t presents;
+	/* from the time a frame was due, or its event arrived, to its present */
+	uint64_t latency_ns;
+	uint64_t max_latency_ns;
+	/* intervals between consecutive presents, for the mean and the jitter */
+	uint64_t intervals;
+	double interval_sum_ns;
+	double interval_sq_sum_ns;
+	uint64_t max_interval_ns;
+	/* presents that were not observed before their slot in the queue was reused */
+	uint64_t dropped;
+};
+
+struct pacer_pending {
+	uint64_t id;
+	uint64_t input_ns;
+};
+
+/*
+ * decides when to start working on a frame and measures when frames reach
+ * the display. present times are reported by the caller, either as completed
+ * by VK_KHR_present_wait or, without it, when the present was queued.
+ */
+struct pacer {
+	enum pacer_mode mode;
+
+	/* moving averages, 0 until measured */
+	uint64_t frame_cost_ns;
+	uint64_t refresh_ns;
+	uint64_t last_present_ns;
+
+	/* how far ahead of now the frame started last was due */
+	uint64_t lead_ns;
+
+	uint32_t pending_head;
+	uint32_t pending_count;
+	struct pacer_pending pending[PACER_MAX_PENDING];
+
+	struct pacer_stats stats;
+};
+
+void pacer_init(struct pacer *ini, enum pacer_mode mode);
+
+/* time to start working on a frame that is due at due_ns */
+uint64_t pacer_wake_time(struct pacer *pacer, uint64_t due_ns);
+
+/* a frame started at begin_ns was queued for present with id */
+void pacer_frame_queued(struct pacer *pacer, uint64_t id, uint64_t input_ns,
+		uint64_t begin_ns, uint64_t end_ns);
+/* the oldest queued present not reported yet, 0 if there is none */
+uint64_t pacer_oldest_pending(const struct pacer *pacer);
+/* reports the present of the oldest pending frame */
+void pacer_frame_presented(struct pacer *pacer, uint64_t present_ns);
+/* forgets presents that will never be reported, e.g. of a retired swapchain */
+void pacer_drop_pending(struct pacer *pacer);
+
+/* standard deviation of the intervals between presents */
+double pacer_jitter_ns(const struct pacer_stats *stats);
+
+#endif
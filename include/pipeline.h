@@ -1,7 +1,11 @@
 #ifndef PIPELINE_H
 #define PIPELINE_H
 
+#include <stdbool.h>
+
+#include "image.h"
 #include "vulkan.h"
+#include "wall.h"
 
 struct graphics_pipeline {
 	VkShaderModule vert_shader;
@@ -16,4 +20,115 @@ VkResult graphics_pipeline_init(struct graphics_pipeline *ini,
 void graphics_pipeline_finish(struct graphics_pipeline *pipeline,
 		struct vulkan_ctx *vk);
 
+/* rgb = rows * (y, cb, cr, 1), with the range expansion folded in */
+struct convert_constants {
+	float rows[3][4];
+};
+
+/*
+ * converts a frame to rgba in a compute shader, reading its planes through
+ * views of their own. bindings 0 to 2 are the planes, nv12 only uses 0 and
+ * 1, and binding 3 is the rgba8 storage image written.
+ */
+struct convert_pipeline {
+	VkShaderModule shader;
+	VkDescriptorSetLayout descriptor_set_layout;
+	VkPipelineLayout pipeline_layout;
+	VkPipeline pipeline;
+	struct convert_constants constants;
+};
+
+/* plane_sampler is a plain sampler, texels are fetched without filtering */
+VkResult convert_pipeline_init(struct convert_pipeline *ini,
+		struct vulkan_ctx *vk, VkSampler plane_sampler, enum image_format format,
+		enum image_color_model model, enum image_color_range range);
+void convert_pipeline_finish(struct convert_pipeline *pipeline,
+		struct vulkan_ctx *vk);
+/* writes the planes of the image in descriptor_set as rgba */
+void convert_pipeline_dispatch(struct convert_pipeline *pipeline,
+		VkCommandBuffer cmd, VkDescriptorSet descriptor_set,
+		uint32_t width, uint32_t height);
+
+
+/*
+ * how frames are scaled into their letterbox. nearest and bilinear sample
+ * the frame once per output pixel through its own sampler. bicubic and
+ * lanczos are separable: a horizontal pass into an intermediate of output
+ * width and source height, then a vertical pass into the output. that is
+ * 4 + 4 taps per output pixel for bicubic and 6 + 6 for lanczos, with the
+ * kernels widened by the ratio when minifying, up to SCALE_MAX_RATIO.
+ */
+enum scale_filter {
+	SCALE_FILTER_NEAREST,
+	SCALE_FILTER_BILINEAR,
+	SCALE_FILTER_BICUBIC,
+	SCALE_FILTER_LANCZOS,
+};
+
+#define SCALE_MAX_RATIO 4.0f
+
+enum scale_pass {
+	SCALE_PASS_HORIZONTAL,
+	SCALE_PASS_VERTICAL,
+	SCALE_PASS_COUNT,
+};
+
+/* axis is (1, 0) or (0, 1), ratio is source over destination, at least 1 */
+struct scale_constants {
+	float axis[2];
+	float ratio;
+};
+
+/*
+ * the horizontal pass samples the frame through its own descriptor set
+ * layout, the vertical one samples the intermediate through this one's.
+ */
+struct scale_pipeline {
+	VkShaderModule vert_shader;
+	VkShaderModule frag_shader;
+	/* fetches texels of the intermediate, without filtering */
+	VkSampler sampler;
+	VkDescriptorSetLayout descriptor_set_layout;
+	VkPipelineLayout pipeline_layouts[SCALE_PASS_COUNT];
+	VkPipeline pipelines[SCALE_PASS_COUNT];
+};
+
+bool scale_filter_separable(enum scale_filter filter);
+
+/*
+ * filter must be separable. intermediate_render_pass renders into the
+ * intermediate, render_pass into the output.
+ */
+VkResult scale_pipeline_init(struct scale_pipeline *ini, struct vulkan_ctx *vk,
+		enum scale_filter filter, VkDescriptorSetLayout source_set_layout,
+		VkRenderPass intermediate_render_pass, VkRenderPass render_pass);
+void scale_pipeline_finish(struct scale_pipeline *pipeline,
+		struct vulkan_ctx *vk);
+/* draws a pass over the viewport, sizes are along the axis of the pass */
+void scale_pipeline_draw(struct scale_pipeline *pipeline, VkCommandBuffer cmd,
+		enum scale_pass pass, VkDescriptorSet descriptor_set,
+		uint32_t src_size, uint32_t dst_size);
+
+
+/*
+ * draws every tile of a wall with a single instanced draw. binding 0 is an
+ * array of WALL_MAX_TILES rgba images, binding 1 the storage buffer of the
+ * tile rects. needs non-uniform indexing of sampled image arrays.
+ */
+struct wall_pipeline {
+	VkShaderModule vert_shader;
+	VkShaderModule frag_shader;
+	VkDescriptorSetLayout descriptor_set_layout;
+	VkPipelineLayout pipeline_layout;
+	VkPipeline pipeline;
+};
+
+/* sampler is a plain one, it is used for every tile */
+VkResult wall_pipeline_init(struct wall_pipeline *ini, struct vulkan_ctx *vk,
+		VkSampler sampler, VkRenderPass render_pass);
+void wall_pipeline_finish(struct wall_pipeline *pipeline, struct vulkan_ctx *vk);
+/* draws ntiles tiles over the viewport */
+void wall_pipeline_draw(struct wall_pipeline *pipeline, VkCommandBuffer cmd,
+		VkDescriptorSet descriptor_set, uint32_t ntiles);
+
 #endif
@@ -0,0 +1,28 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+
+/*
+ * the pipeline cache of a device, kept in a file per device under
+ * $XDG_CACHE_HOME, or ~/.cache without it. a file is only used if its header
+ * names the same vendor, device and pipelineCacheUUID, the last of which
+ * changes with the driver. otherwise the cache starts out empty and the file
+ * is replaced on save.
+ */
+
+/* NULL if neither $XDG_CACHE_HOME nor $HOME is set, free() the result */
+char *pipeline_cache_path(const VkPhysicalDeviceProperties *properties);
+
+/*
+ * creates cache from the file at path, or empty if path is NULL or holds no
+ * cache of this device. warm tells which of the two it was.
+ */
+VkResult pipeline_cache_load(VkDevice device,
+		const VkPhysicalDeviceProperties *properties, const char *path,
+		VkPipelineCache *cache, bool *warm);
+/* writes to a temporary file next to path first, so readers never see half */
+int pipeline_cache_save(VkDevice device, VkPipelineCache cache, const char *path);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sequence.h"
+
+struct readahead_stats {
+	uint64_t frames_faulted;
+	/* frames the consumer had to wait for */
+	uint64_t stalls;
+	uint64_t stall_ns;
+	uint64_t max_stall_ns;
+};
+
+/*
+ * faults in the pages of the next depth frames of a sequence on a background
+ * thread, so that copies out of the mapping don't hit cold pages. frames are
+ * absolute, frame n maps to frame n % frame_count of the sequence.
+ */
+struct readahead {
+	const struct sequence *sequence;
+	uint32_t depth;
+	long page_size;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+
+	/* protected by lock, frames from position to faulted_until are resident */
+	uint64_t position;
+	uint64_t faulted_until;
+	bool stop;
+
+	struct readahead_stats stats;
+};
+
+int readahead_init(struct readahead *ini, const struct sequence *sequence,
+		uint32_t depth);
+void readahead_finish(struct readahead *readahead);
+
+/* moves the window to frame and blocks until frame is resident */
+void readahead_wait(struct readahead *readahead, uint64_t frame);
+void readahead_get_stats(struct readahead *readahead,
+		struct readahead_stats *stats);
+
+#endif
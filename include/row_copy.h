@@ -0,0 +1,33 @@
+#ifndef ROW_COPY_H
+#define ROW_COPY_H
+
+#include <stddef.h>
+
+enum row_copy_kernel {
+	/* one memcpy per row */
+	ROW_COPY_KERNEL_SCALAR,
+	/* 16 byte non-temporal stores */
+	ROW_COPY_KERNEL_SSE2,
+	/* 32 byte non-temporal stores */
+	ROW_COPY_KERNEL_AVX2,
+	ROW_COPY_KERNEL_COUNT,
+};
+
+typedef void (*row_copy_fn)(void *dst, size_t dst_pitch,
+		const void *src, size_t src_pitch, size_t width, size_t rows);
+
+/* NULL if the kernel was not built in or the cpu does not support it */
+row_copy_fn row_copy_get_kernel(enum row_copy_kernel kernel);
+const char *row_copy_kernel_name(enum row_copy_kernel kernel);
+/* the fastest kernel the cpu supports, chosen once */
+enum row_copy_kernel row_copy_best_kernel(void);
+
+/*
+ * copies rows of width bytes with the best kernel. meant for memory the cpu
+ * only writes, like write-combined mappings: the data does not end up in the
+ * cache and all stores are fenced before it returns.
+ */
+void row_copy(void *dst, size_t dst_pitch,
+		const void *src, size_t src_pitch, size_t width, size_t rows);
+
+#endif
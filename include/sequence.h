@@ -0,0 +1,48 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image.h"
+
+enum sequence_container {
+	/* planar frames back to back, the geometry has to be given */
+	SEQUENCE_CONTAINER_RAW,
+	/* YUV4MPEG2, the geometry comes from the stream header */
+	SEQUENCE_CONTAINER_Y4M,
+	/* generated in anonymous memory, nothing is read */
+	SEQUENCE_CONTAINER_SYNTHETIC,
+};
+
+/* a planar file mapped as a sequence of equally sized frames */
+struct sequence {
+	void *mapped_ptr;
+	size_t mapped_size;
+	enum sequence_container container;
+
+	enum image_format format;
+	uint32_t width;
+	uint32_t height;
+	/* frame rate from the stream header, 0 if the file has none */
+	double fps;
+
+	size_t frame_size;
+	uint32_t frame_count;
+	/* offsets of the frame payloads, NULL if frames are back to back */
+	size_t *frame_offsets;
+};
+
+/*
+ * y4m files are recognized by their signature and describe themselves,
+ * width, height and format are only used for raw files.
+ */
+int sequence_open(struct sequence *ini, const char *file,
+		uint32_t width, uint32_t height, enum image_format format);
+/* frame_count frames of a gradient that moves from frame to frame */
+int sequence_generate(struct sequence *ini, uint32_t width, uint32_t height,
+		enum image_format format, uint32_t frame_count);
+const void *sequence_frame(const struct sequence *sequence, uint32_t frame);
+void sequence_close(struct sequence *sequence);
+
+#endif
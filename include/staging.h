@@ -0,0 +1,49 @@
+#ifndef STAGING_H
+#define STAGING_H
+
+#include "vulkan.h"
+
+#define STAGING_RING_MAX_REGIONS 64
+
+/* regions allocated but not yet handed to staging_ring_submit */
+#define STAGING_RING_PENDING UINT64_MAX
+
+struct staging_ring_region {
+	VkDeviceSize begin;
+	VkDeviceSize end;
+	/* timeline value after which the region can be reused */
+	uint64_t value;
+};
+
+/*
+ * a persistently mapped host-visible buffer handed out in fifo order.
+ * regions are retired once the timeline semaphore reaches the value they
+ * were submitted with, so allocating never maps memory or calls into the
+ * allocator.
+ */
+struct staging_ring {
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	uint8_t *mapped_ptr;
+	VkDeviceSize size;
+
+	VkSemaphore timeline;
+	VkDeviceSize head;
+
+	struct staging_ring_region regions[STAGING_RING_MAX_REGIONS];
+	uint32_t first_region;
+	uint32_t nregions;
+
+	/* time allocations spent blocked until the gpu retired a region */
+	uint64_t wait_ns;
+};
+
+VkResult staging_ring_init(struct staging_ring *ini, struct vulkan_ctx *vk,
+		VkDeviceSize size, VkSemaphore timeline);
+void staging_ring_finish(struct staging_ring *ring, struct vulkan_ctx *vk);
+
+VkResult staging_ring_alloc(struct staging_ring *ring, struct vulkan_ctx *vk,
+		VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize *offset);
+void staging_ring_submit(struct staging_ring *ring, uint64_t value);
+
+#endif
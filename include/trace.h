@@ -0,0 +1,59 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * records cpu and gpu intervals as chrome trace json, which chrome://tracing
+ * and perfetto open. all times are CLOCK_MONOTONIC. while no trace is open a
+ * marker costs a load and a branch.
+ */
+
+extern bool trace_enabled;
+
+/* gpu work is drawn on tracks of its own, apart from the cpu threads */
+enum trace_gpu_track {
+	TRACE_GPU_TRACK_RENDER,
+	TRACE_GPU_TRACK_UPLOAD,
+	TRACE_GPU_TRACK_COUNT,
+};
+
+int trace_open(const char *path);
+void trace_close(void);
+
+uint64_t trace_now_ns(void);
+/* an interval on the calling thread */
+void trace_cpu(const char *name, uint64_t begin_ns, uint64_t end_ns);
+/* an interval of gpu work, converted to CLOCK_MONOTONIC by the caller */
+void trace_gpu(const char *name, enum trace_gpu_track track,
+		uint64_t begin_ns, uint64_t end_ns);
+
+struct trace_scope {
+	const char *name;
+	uint64_t begin_ns;
+};
+
+static inline struct trace_scope
+trace_scope_begin(const char *name) {
+	return (struct trace_scope) {
+		.name = name,
+		.begin_ns = trace_enabled ? trace_now_ns() : 0,
+	};
+}
+
+static inline void
+trace_scope_end(struct trace_scope *scope) {
+	if (scope->begin_ns != 0) {
+		trace_cpu(scope->name, scope->begin_ns, trace_now_ns());
+	}
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+/* traces from here to the end of the enclosing block */
+#define TRACE_SCOPE(name) \
+	struct trace_scope TRACE_CONCAT(trace_scope_, __LINE__) \
+		__attribute__((cleanup(trace_scope_end))) = trace_scope_begin(name)
+
+#endif
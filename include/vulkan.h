@@ -4,13 +4,31 @@
 #include <stdbool.h>
 #include <vulkan/vulkan.h>
 
+#include "allocator.h"
+
 struct vulkan_ctx_features {
+	/* no surface or swapchain extensions, for rendering without a display */
+	bool headless;
 	bool enable_ycbcr_conversion;
+	bool enable_timeline_semaphore;
+	/* only enabled if the device supports VK_EXT_external_memory_host */
+	bool enable_external_memory_host;
+	/* only enabled if the device supports VK_KHR_present_id and present_wait */
+	bool enable_present_wait;
+	/* only enabled if VK_EXT_calibrated_timestamps covers CLOCK_MONOTONIC */
+	bool enable_calibrated_timestamps;
+	/* only enabled if sampled image arrays can be indexed non-uniformly */
+	bool enable_descriptor_indexing;
+	/* pipelines are created through a cache kept on disk between runs */
+	bool enable_pipeline_cache;
+	/* starts the cache out empty, it still replaces the one on disk */
+	bool cold_pipeline_cache;
 };
 
 struct vulkan_ctx {
     VkInstance instance;
     VkPhysicalDevice physical_device;
+    VkPhysicalDeviceProperties physical_device_properties;
     VkDevice device;
 
     uint32_t queue_family_index;
@@ -19,6 +37,36 @@ struct vulkan_ctx {
 	VkPhysicalDeviceMemoryProperties memory_properties;
 	uint32_t host_visible_memory_index;
 	uint32_t device_local_memory_index;
+
+	/* sub-allocates device memory for images out of larger blocks */
+	struct memory_allocator allocator;
+
+	/* VK_EXT_external_memory_host, host pointers and sizes must be aligned */
+	bool external_memory_host;
+	VkDeviceSize min_imported_host_pointer_alignment;
+	/* maxMemoryAllocationSize, imports are single allocations too */
+	VkDeviceSize max_memory_allocation_size;
+	PFN_vkGetMemoryHostPointerPropertiesEXT get_memory_host_pointer_properties;
+
+	/* VK_KHR_present_id and VK_KHR_present_wait, presents carry an id to wait on */
+	bool present_wait;
+	PFN_vkWaitForPresentKHR wait_for_present;
+
+	/* VK_EXT_calibrated_timestamps, samples the device and CLOCK_MONOTONIC together */
+	bool calibrated_timestamps;
+	PFN_vkGetCalibratedTimestampsEXT get_calibrated_timestamps;
+
+	/* timelineSemaphore, staging uploads and frames in flight wait on timelines */
+	bool timeline_semaphore;
+
+	/* shaderSampledImageArrayNonUniformIndexing of descriptor indexing */
+	bool descriptor_indexing;
+
+	/* VK_NULL_HANDLE unless enabled, saved to pipeline_cache_path on destroy */
+	VkPipelineCache pipeline_cache;
+	char *pipeline_cache_path;
+	/* the cache was loaded with pipelines of an earlier run */
+	bool pipeline_cache_warm;
 };
 
 struct vulkan_ctx *vulkan_ctx_create(struct vulkan_ctx_features *features);
@@ -26,8 +74,13 @@ void vulkan_ctx_destroy(struct vulkan_ctx *ctx);
 
 VkResult vulkan_ctx_create_fence(struct vulkan_ctx *ctx, VkFence *fence, bool init);
 VkResult vulkan_ctx_create_semaphore(struct vulkan_ctx *ctx, VkSemaphore *semaphore);
+VkResult vulkan_ctx_create_timeline_semaphore(struct vulkan_ctx *ctx,
+		VkSemaphore *semaphore, uint64_t initial_value);
 VkResult vulkan_ctx_create_cmd_pool(struct vulkan_ctx *ctx, VkCommandPool *cmd_pool,
 		VkCommandPoolCreateFlags flags);
+VkResult vulkan_ctx_import_host_buffer(struct vulkan_ctx *ctx,
+		void *host_ptr, VkDeviceSize size, VkBufferUsageFlags usage,
+		VkBuffer *buffer, VkDeviceMemory *memory);
 VkResult vulkan_ctx_create_shader_module(struct vulkan_ctx *ctx,
 		VkShaderModule *shader_module, size_t code_size, const void *code);
 
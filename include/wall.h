@@ -0,0 +1,36 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vulkan.h"
+
+/* tiles a wall holds at most, the size of the wall shader's image array */
+#define WALL_MAX_TILES 64
+
+/*
+ * a grid of tiles showing a stream each, as close to square as their count
+ * allows. the last row may be incomplete. every tile has the aspect ratio of
+ * the streams, so the whole wall is letterboxed like a single stream.
+ */
+struct wall {
+	uint32_t ntiles;
+	uint32_t columns;
+	uint32_t rows;
+
+	/* x, y, width and height of each tile, as fractions of the wall */
+	VkBuffer rect_buffer;
+	struct memory_allocation rect_allocation;
+};
+
+VkResult wall_init(struct wall *ini, struct vulkan_ctx *vk, uint32_t ntiles);
+void wall_finish(struct wall *wall, struct vulkan_ctx *vk);
+
+/* how many streams wide and high the wall is, to letterbox it */
+void wall_size(const struct wall *wall, uint32_t tile_width, uint32_t tile_height,
+		uint32_t *width, uint32_t *height);
+/* the cells after the last tile within viewport, false if there are none */
+bool wall_empty_rect(const struct wall *wall, VkRect2D viewport, VkRect2D *rect);
+
+#endif
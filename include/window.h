@@ -13,14 +13,20 @@ struct window {
 	xcb_atom_t atom_delete_window;
 	bool close_requested;
 
+	/* set when the size changed, however many configures led there */
 	bool resized;
 	int16_t width;
 	int16_t height;
+
+	/* set when the window contents have to be drawn again */
+	bool damaged;
 };
 
 struct window *window_create();
 void window_destroy(struct window *window);
 void window_show(struct window *window);
 void window_poll_event(struct window *window);
+/* blocks until an event arrives or timeout_ms passes, -1 waits forever */
+void window_wait_event(struct window *window, int timeout_ms);
 
 #endif
@@ -0,0 +1,43 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define WORKER_POOL_MAX_THREADS 32
+
+typedef void (*worker_pool_fn)(void *job);
+
+/*
+ * a fixed set of threads that run batches of jobs. the thread calling
+ * worker_pool_run takes part in the batch and returns once every job of it
+ * has finished, so a pool of n workers only spawns n - 1 threads.
+ */
+struct worker_pool {
+	uint32_t nworkers;
+	pthread_t threads[WORKER_POOL_MAX_THREADS];
+
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+
+	/* the current batch, protected by lock */
+	worker_pool_fn fn;
+	uint8_t *jobs;
+	size_t job_size;
+	uint32_t njobs;
+	uint32_t next_job;
+	uint32_t finished_jobs;
+	uint64_t batch;
+	bool stop;
+};
+
+int worker_pool_init(struct worker_pool *ini, uint32_t nworkers);
+void worker_pool_finish(struct worker_pool *pool);
+
+void worker_pool_run(struct worker_pool *pool, worker_pool_fn fn,
+		void *jobs, size_t job_size, uint32_t njobs);
+
+#endif
@@ -0,0 +1,365 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+
+struct memory_chunk {
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	bool free;
+	bool linear;
+
+	struct memory_chunk *prev;
+	struct memory_chunk *next;
+};
+
+struct memory_block {
+	uint32_t memory_index;
+	VkDeviceMemory memory;
+	VkDeviceSize size;
+	void *mapped_ptr;
+
+	/* sorted by offset, covering the whole block without gaps */
+	struct memory_chunk *chunks;
+	struct memory_block *next;
+};
+
+static VkDeviceSize
+align_up(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool
+on_same_page(VkDeviceSize a, VkDeviceSize b, VkDeviceSize page_size) {
+	return a / page_size == b / page_size;
+}
+
+void
+memory_allocator_init(struct memory_allocator *ini, VkDevice device,
+		const VkPhysicalDeviceMemoryProperties *memory_properties,
+		VkDeviceSize buffer_image_granularity) {
+	ini->device = device;
+	ini->memory_properties = memory_properties;
+	ini->block_size = MEMORY_ALLOCATOR_BLOCK_SIZE;
+	ini->buffer_image_granularity = buffer_image_granularity > 0
+		? buffer_image_granularity : 1;
+	pthread_mutex_init(&ini->lock, NULL);
+
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+		ini->pools[i].memory_index = i;
+		ini->pools[i].blocks = NULL;
+	}
+}
+
+static void
+destroy_block(struct memory_allocator *allocator, struct memory_block *block) {
+	struct memory_chunk *chunk = block->chunks;
+	while (chunk != NULL) {
+		struct memory_chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+
+	if (block->mapped_ptr != NULL) {
+		vkUnmapMemory(allocator->device, block->memory);
+	}
+	vkFreeMemory(allocator->device, block->memory, NULL);
+	free(block);
+}
+
+void
+memory_allocator_finish(struct memory_allocator *allocator) {
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+		struct memory_block *block = allocator->pools[i].blocks;
+		while (block != NULL) {
+			struct memory_block *next = block->next;
+			destroy_block(allocator, block);
+			block = next;
+		}
+		allocator->pools[i].blocks = NULL;
+	}
+	pthread_mutex_destroy(&allocator->lock);
+}
+
+static VkResult
+create_block(struct memory_allocator *allocator, uint32_t memory_index,
+		VkDeviceSize size, struct memory_block **out) {
+	VkResult res;
+
+	VkDeviceMemory memory;
+	VkMemoryAllocateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.pNext = NULL,
+		.memoryTypeIndex = memory_index,
+		.allocationSize = size,
+	};
+	res = vkAllocateMemory(allocator->device, &info, NULL, &memory);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "create_block - vkAllocateMemory failed\n");
+		return res;
+	}
+
+	/* host visible blocks stay mapped, a memory can only be mapped once */
+	void *mapped_ptr = NULL;
+	VkMemoryPropertyFlags flags =
+		allocator->memory_properties->memoryTypes[memory_index].propertyFlags;
+	if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		res = vkMapMemory(allocator->device, memory, 0, VK_WHOLE_SIZE,
+				0, &mapped_ptr);
+		if (res != VK_SUCCESS) {
+			fprintf(stderr, "create_block - vkMapMemory failed\n");
+			vkFreeMemory(allocator->device, memory, NULL);
+			return res;
+		}
+	}
+
+	struct memory_block *block = calloc(1, sizeof(struct memory_block));
+	struct memory_chunk *chunk = calloc(1, sizeof(struct memory_chunk));
+	chunk->offset = 0;
+	chunk->size = size;
+	chunk->free = true;
+
+	block->memory_index = memory_index;
+	block->memory = memory;
+	block->size = size;
+	block->mapped_ptr = mapped_ptr;
+	block->chunks = chunk;
+
+	struct memory_pool *pool = &allocator->pools[memory_index];
+	block->next = pool->blocks;
+	pool->blocks = block;
+
+	*out = block;
+	return VK_SUCCESS;
+}
+
+/* finds where an allocation would start inside a free chunk, if it fits */
+static bool
+fit_in_chunk(struct memory_allocator *allocator, struct memory_chunk *chunk,
+		VkDeviceSize size, VkDeviceSize alignment, bool linear,
+		VkDeviceSize *offset) {
+	VkDeviceSize granularity = allocator->buffer_image_granularity;
+	VkDeviceSize candidate = align_up(chunk->offset, alignment);
+
+	struct memory_chunk *prev = chunk->prev;
+	if (prev != NULL && !prev->free && prev->linear != linear
+			&& on_same_page(prev->offset + prev->size - 1, candidate, granularity)) {
+		candidate = align_up(candidate, granularity);
+	}
+
+	if (candidate + size > chunk->offset + chunk->size) {
+		return false;
+	}
+
+	struct memory_chunk *next = chunk->next;
+	if (next != NULL && !next->free && next->linear != linear
+			&& on_same_page(candidate + size - 1, next->offset, granularity)) {
+		return false;
+	}
+
+	*offset = candidate;
+	return true;
+}
+
+static struct memory_chunk *
+split_chunk(struct memory_chunk *chunk, VkDeviceSize offset) {
+	struct memory_chunk *tail = calloc(1, sizeof(struct memory_chunk));
+	tail->offset = offset;
+	tail->size = chunk->offset + chunk->size - offset;
+	tail->free = chunk->free;
+	tail->linear = chunk->linear;
+	tail->prev = chunk;
+	tail->next = chunk->next;
+	if (chunk->next != NULL) {
+		chunk->next->prev = tail;
+	}
+	chunk->next = tail;
+	chunk->size = offset - chunk->offset;
+	return tail;
+}
+
+static struct memory_chunk *
+take_chunk(struct memory_chunk *chunk, VkDeviceSize offset, VkDeviceSize size,
+		bool linear) {
+	/* alignment padding in front stays behind as a free chunk */
+	if (offset > chunk->offset) {
+		chunk = split_chunk(chunk, offset);
+	}
+	if (chunk->size > size) {
+		split_chunk(chunk, offset + size);
+	}
+
+	chunk->free = false;
+	chunk->linear = linear;
+	return chunk;
+}
+
+static VkResult
+alloc_locked(struct memory_allocator *allocator,
+		const VkMemoryRequirements *requirements, uint32_t memory_index,
+		bool linear, struct memory_allocation *allocation) {
+	VkDeviceSize size = requirements->size;
+	VkDeviceSize alignment = requirements->alignment > 0
+		? requirements->alignment : 1;
+
+	struct memory_block *block = allocator->pools[memory_index].blocks;
+	struct memory_chunk *chunk = NULL;
+	VkDeviceSize offset = 0;
+	for (; block != NULL; block = block->next) {
+		for (chunk = block->chunks; chunk != NULL; chunk = chunk->next) {
+			if (chunk->free && fit_in_chunk(allocator, chunk,
+						size, alignment, linear, &offset)) {
+				break;
+			}
+		}
+		if (chunk != NULL) {
+			break;
+		}
+	}
+
+	if (block == NULL) {
+		/* oversized requests get a block of their own */
+		VkDeviceSize block_size = allocator->block_size;
+		if (size > block_size) {
+			block_size = size;
+		}
+
+		VkResult res = create_block(allocator, memory_index, block_size, &block);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+		chunk = block->chunks;
+		offset = 0;
+	}
+
+	chunk = take_chunk(chunk, offset, size, linear);
+
+	allocation->memory = block->memory;
+	allocation->offset = offset;
+	allocation->size = size;
+	allocation->mapped_ptr = block->mapped_ptr != NULL
+		? (uint8_t *) block->mapped_ptr + offset : NULL;
+	allocation->block = block;
+	allocation->chunk = chunk;
+	return VK_SUCCESS;
+}
+
+VkResult
+memory_allocator_alloc(struct memory_allocator *allocator,
+		const VkMemoryRequirements *requirements, uint32_t memory_index,
+		bool linear, struct memory_allocation *allocation) {
+	assert(requirements->memoryTypeBits & (1 << memory_index));
+
+	pthread_mutex_lock(&allocator->lock);
+	VkResult res = alloc_locked(allocator, requirements, memory_index,
+			linear, allocation);
+	pthread_mutex_unlock(&allocator->lock);
+	return res;
+}
+
+static void
+merge_with_next(struct memory_chunk *chunk) {
+	struct memory_chunk *next = chunk->next;
+	chunk->size += next->size;
+	chunk->next = next->next;
+	if (next->next != NULL) {
+		next->next->prev = chunk;
+	}
+	free(next);
+}
+
+static void
+free_locked(struct memory_allocator *allocator,
+		struct memory_allocation *allocation) {
+	struct memory_block *block = allocation->block;
+	struct memory_chunk *chunk = allocation->chunk;
+
+	chunk->free = true;
+	if (chunk->next != NULL && chunk->next->free) {
+		merge_with_next(chunk);
+	}
+	if (chunk->prev != NULL && chunk->prev->free) {
+		chunk = chunk->prev;
+		merge_with_next(chunk);
+	}
+
+	allocation->memory = VK_NULL_HANDLE;
+	allocation->mapped_ptr = NULL;
+	allocation->block = NULL;
+	allocation->chunk = NULL;
+
+	/* keep the last block of a pool around, release other empty ones */
+	struct memory_pool *pool = &allocator->pools[block->memory_index];
+	bool empty = block->chunks->free && block->chunks->next == NULL;
+	if (!empty || (pool->blocks == block && block->next == NULL)) {
+		return;
+	}
+
+	struct memory_block **link = &pool->blocks;
+	while (*link != block) {
+		link = &(*link)->next;
+	}
+	*link = block->next;
+	destroy_block(allocator, block);
+}
+
+void
+memory_allocator_free(struct memory_allocator *allocator,
+		struct memory_allocation *allocation) {
+	if (allocation->block == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&allocator->lock);
+	free_locked(allocator, allocation);
+	pthread_mutex_unlock(&allocator->lock);
+}
+
+void
+memory_allocator_get_stats(struct memory_allocator *allocator,
+		uint32_t memory_index, struct memory_stats *stats) {
+	*stats = (struct memory_stats) { 0 };
+
+	pthread_mutex_lock(&allocator->lock);
+	struct memory_block *block = allocator->pools[memory_index].blocks;
+	for (; block != NULL; block = block->next) {
+		stats->block_count++;
+		stats->block_bytes += block->size;
+
+		struct memory_chunk *chunk = block->chunks;
+		for (; chunk != NULL; chunk = chunk->next) {
+			if (!chunk->free) {
+				stats->allocation_count++;
+				stats->used_bytes += chunk->size;
+			} else {
+				stats->free_chunk_count++;
+				if (chunk->size > stats->largest_free_chunk) {
+					stats->largest_free_chunk = chunk->size;
+				}
+			}
+		}
+	}
+	pthread_mutex_unlock(&allocator->lock);
+}
+
+void
+memory_allocator_print_stats(struct memory_allocator *allocator) {
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+		struct memory_stats stats;
+		memory_allocator_get_stats(allocator, i, &stats);
+		if (stats.block_count == 0) {
+			continue;
+		}
+
+		/* share of the free space that is not in the largest free chunk */
+		VkDeviceSize free_bytes = stats.block_bytes - stats.used_bytes;
+		double fragmentation = free_bytes > 0
+			? 1.0 - (double) stats.largest_free_chunk / free_bytes : 0.0;
+		printf("memory type %u: %u blocks (%.1f MiB), %u allocations "
+				"(%.1f MiB), %u free chunks, %.1f%% fragmented\n",
+				i, stats.block_count, stats.block_bytes / (1024.0 * 1024.0),
+				stats.allocation_count, stats.used_bytes / (1024.0 * 1024.0),
+				stats.free_chunk_count, fragmentation * 100.0);
+	}
+}
@@ -0,0 +1,220 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gpu_timer.h"
+#include "trace.h"
+
+static const char *stage_names[GPU_STAGE_COUNT] = {
+	[GPU_STAGE_UPLOAD_COPY] = "upload copy",
+	[GPU_STAGE_DRAW] = "draw",
+	[GPU_STAGE_FRAME] = "frame",
+};
+
+void
+gpu_timings_init(struct gpu_timings *ini) {
+	memset(ini, 0, sizeof(struct gpu_timings));
+}
+
+static void
+add_sample(struct gpu_stage_stats *stats, double ns) {
+	if (stats->count == 0 || ns < stats->min_ns) {
+		stats->min_ns = ns;
+	}
+	if (ns > stats->max_ns) {
+		stats->max_ns = ns;
+	}
+	stats->total_ns += ns;
+	stats->samples[stats->count % GPU_TIMER_SAMPLES] = ns;
+	stats->count++;
+}
+
+static int
+compare_double(const void *a, const void *b) {
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+void
+gpu_timings_print(const struct gpu_timings *timings) {
+	double sorted[GPU_TIMER_SAMPLES];
+	for (int stage = 0; stage < GPU_STAGE_COUNT; stage++) {
+		const struct gpu_stage_stats *stats = &timings->stages[stage];
+		if (stats->count == 0) {
+			continue;
+		}
+
+		uint32_t nsamples = stats->count < GPU_TIMER_SAMPLES
+			? stats->count : GPU_TIMER_SAMPLES;
+		memcpy(sorted, stats->samples, nsamples * sizeof(double));
+		qsort(sorted, nsamples, sizeof(double), compare_double);
+		uint32_t p99 = (nsamples * 99 + 99) / 100 - 1;
+
+		printf("gpu %-11s %8" PRIu64 " times, min %.3fms, avg %.3fms, "
+				"p99 %.3fms, max %.3fms\n", stage_names[stage], stats->count,
+				stats->min_ns / 1e6, stats->total_ns / 1e6 / stats->count,
+				sorted[p99] / 1e6, stats->max_ns / 1e6);
+	}
+}
+
+VkResult
+gpu_timer_init(struct gpu_timer *ini, struct vulkan_ctx *vk,
+		struct gpu_timings *timings, uint32_t nsets) {
+	memset(ini, 0, sizeof(struct gpu_timer));
+	ini->timings = timings;
+
+	uint32_t count = 8;
+	VkQueueFamilyProperties properties[8];
+	vkGetPhysicalDeviceQueueFamilyProperties(vk->physical_device, &count, properties);
+	uint32_t valid_bits = vk->queue_family_index < count
+		? properties[vk->queue_family_index].timestampValidBits : 0;
+	if (valid_bits == 0) {
+		fprintf(stderr, "gpu_timer_init - queue doesn't support timestamps... "
+				"not timing the gpu\n");
+		return VK_SUCCESS;
+	}
+	ini->valid_mask = valid_bits >= 64 ? UINT64_MAX : (UINT64_C(1) << valid_bits) - 1;
+	ini->period_ns = vk->physical_device_properties.limits.timestampPeriod;
+
+	ini->pools = calloc(nsets, sizeof(VkQueryPool));
+	ini->written = calloc(nsets, sizeof(uint32_t));
+	if (ini->pools == NULL || ini->written == NULL) {
+		gpu_timer_finish(ini, vk);
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	VkQueryPoolCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = 2 * GPU_STAGE_COUNT,
+	};
+	for (uint32_t set = 0; set < nsets; set++) {
+		VkResult res = vkCreateQueryPool(vk->device, &create_info, NULL,
+				&ini->pools[set]);
+		if (res != VK_SUCCESS) {
+			gpu_timer_finish(ini, vk);
+			return res;
+		}
+		ini->nsets++;
+	}
+	return VK_SUCCESS;
+}
+
+void
+gpu_timer_finish(struct gpu_timer *timer, struct vulkan_ctx *vk) {
+	for (uint32_t set = 0; set < timer->nsets; set++) {
+		vkDestroyQueryPool(vk->device, timer->pools[set], NULL);
+	}
+	free(timer->pools);
+	free(timer->written);
+	timer->pools = NULL;
+	timer->written = NULL;
+	timer->nsets = 0;
+}
+
+bool
+gpu_timer_enabled(const struct gpu_timer *timer) {
+	return timer->nsets > 0;
+}
+
+/* samples both clocks together, so device ticks can be put on CLOCK_MONOTONIC */
+static bool
+calibrate(struct gpu_timer *timer, struct vulkan_ctx *vk, double *offset_ns) {
+	if (!vk->calibrated_timestamps) {
+		return false;
+	}
+
+	VkCalibratedTimestampInfoEXT infos[2] = {
+		{
+			.sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+			.timeDomain = VK_TIME_DOMAIN_DEVICE_EXT,
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+			.timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT,
+		},
+	};
+	uint64_t timestamps[2], max_deviation;
+	VkResult res = vk->get_calibrated_timestamps(vk->device, 2, infos,
+			timestamps, &max_deviation);
+	if (res != VK_SUCCESS) {
+		return false;
+	}
+	*offset_ns = (double) timestamps[1]
+		- (double) (timestamps[0] & timer->valid_mask) * timer->period_ns;
+	return true;
+}
+
+/* reads without waiting, stages whose timestamps aren't available are skipped */
+static void
+collect_set(struct gpu_timer *timer, struct vulkan_ctx *vk, uint32_t set) {
+	double offset_ns;
+	bool traced = trace_enabled && timer->written[set] != 0
+		&& calibrate(timer, vk, &offset_ns);
+
+	for (int stage = 0; stage < GPU_STAGE_COUNT; stage++) {
+		if (!(timer->written[set] & (1u << stage))) {
+			continue;
+		}
+
+		/* begin and end, each followed by its availability */
+		uint64_t results[4];
+		VkResult res = vkGetQueryPoolResults(vk->device, timer->pools[set],
+				2 * stage, 2, sizeof(results), results, 2 * sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if ((res != VK_SUCCESS && res != VK_NOT_READY) || !results[1] || !results[3]) {
+			continue;
+		}
+
+		uint64_t ticks = (results[2] - results[0]) & timer->valid_mask;
+		add_sample(&timer->timings->stages[stage], ticks * timer->period_ns);
+
+		if (traced) {
+			double begin_ns = (results[0] & timer->valid_mask) * timer->period_ns
+				+ offset_ns;
+			enum trace_gpu_track track = stage == GPU_STAGE_UPLOAD_COPY
+				? TRACE_GPU_TRACK_UPLOAD : TRACE_GPU_TRACK_RENDER;
+			trace_gpu(stage_names[stage], track, (uint64_t) begin_ns,
+					(uint64_t) (begin_ns + ticks * timer->period_ns));
+		}
+	}
+	timer->written[set] = 0;
+}
+
+void
+gpu_timer_reset(struct gpu_timer *timer, struct vulkan_ctx *vk,
+		VkCommandBuffer cmd, uint32_t set) {
+	if (!gpu_timer_enabled(timer)) {
+		return;
+	}
+	collect_set(timer, vk, set);
+	vkCmdResetQueryPool(cmd, timer->pools[set], 0, 2 * GPU_STAGE_COUNT);
+}
+
+void
+gpu_timer_begin(struct gpu_timer *timer, VkCommandBuffer cmd,
+		uint32_t set, enum gpu_stage stage, VkPipelineStageFlagBits pipeline_stage) {
+	if (!gpu_timer_enabled(timer)) {
+		return;
+	}
+	vkCmdWriteTimestamp(cmd, pipeline_stage, timer->pools[set], 2 * stage);
+}
+
+void
+gpu_timer_end(struct gpu_timer *timer, VkCommandBuffer cmd,
+		uint32_t set, enum gpu_stage stage, VkPipelineStageFlagBits pipeline_stage) {
+	if (!gpu_timer_enabled(timer)) {
+		return;
+	}
+	vkCmdWriteTimestamp(cmd, pipeline_stage, timer->pools[set], 2 * stage + 1);
+	timer->written[set] |= 1u << stage;
+}
+
+void
+gpu_timer_collect_all(struct gpu_timer *timer, struct vulkan_ctx *vk) {
+	for (uint32_t set = 0; set < timer->nsets; set++) {
+		collect_set(timer, vk, set);
+	}
+}
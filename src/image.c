@@ -1,45 +1,97 @@
 #include <assert.h>
-#include <fcntl.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/mman.h>
-#include <unistd.h>
+#include <time.h>
 
 #include "image.h"
+#include "row_copy.h"
+#include "sequence.h"
+#include "staging.h"
+#include "trace.h"
+
+static const VkImageAspectFlagBits plane_aspects[3] = {
+	VK_IMAGE_ASPECT_PLANE_0_BIT,
+	VK_IMAGE_ASPECT_PLANE_1_BIT,
+	VK_IMAGE_ASPECT_PLANE_2_BIT,
+};
+
+/* planes shorter than this many rows per band are not worth splitting */
+#define MIN_BAND_ROWS 64
+#define MAX_ROW_BANDS (3 * WORKER_POOL_MAX_THREADS)
+
+struct row_band {
+	uint8_t *dst;
+	VkDeviceSize dst_pitch;
+	const uint8_t *src;
+	uint32_t width;
+	uint32_t rows;
+};
 
-static VkResult
-copy_to_memory(struct vulkan_ctx *vk, VkDeviceMemory dst,
-		const VkSubresourceLayout *layout,
-		uint32_t width, uint32_t height, const void *data) {
-	VkResult res;
-
-	void *dst_ptr;
-	res = vkMapMemory(vk->device, dst, layout->offset, layout->size, 0, &dst_ptr);
-	if (res != VK_SUCCESS) {
-		return res;
-	}
+static void
+copy_row_band(void *job) {
+	TRACE_SCOPE("copy_row_band");
+	const struct row_band *band = job;
+	row_copy(band->dst, band->dst_pitch, band->src, band->width,
+			band->width, band->rows);
+}
 
-	if (layout->rowPitch != width) {
-		for (uint32_t row = 0; row < height; row++) {
-			memcpy(dst_ptr + row * layout->rowPitch, data + row * width, width);
+void
+image_copy_to_memory(struct worker_pool *workers,
+		const struct image_plane_copy *planes, uint32_t plane_count) {
+	TRACE_SCOPE("copy_to_memory");
+	struct row_band bands[MAX_ROW_BANDS];
+	uint32_t band_count = 0;
+
+	for (uint32_t plane = 0; plane < plane_count; plane++) {
+		const struct image_plane_copy *copy = &planes[plane];
+		uint8_t *dst_ptr = (uint8_t *) copy->dst + copy->layout.offset;
+
+		uint32_t plane_bands = copy->height / MIN_BAND_ROWS;
+		if (plane_bands > workers->nworkers) {
+			plane_bands = workers->nworkers;
+		} else if (plane_bands < 1) {
+			plane_bands = 1;
+		}
+		uint32_t band_rows = (copy->height + plane_bands - 1) / plane_bands;
+
+		for (uint32_t row = 0; row < copy->height; row += band_rows) {
+			uint32_t rows = copy->height - row;
+			if (rows > band_rows) {
+				rows = band_rows;
+			}
+
+			assert(band_count < MAX_ROW_BANDS);
+			bands[band_count++] = (struct row_band) {
+				.dst = dst_ptr + row * copy->layout.rowPitch,
+				.dst_pitch = copy->layout.rowPitch,
+				.src = (const uint8_t *) copy->data + (size_t) row * copy->width,
+				.width = copy->width,
+				.rows = rows,
+			};
 		}
-	} else {
-		memcpy(dst_ptr, data, width * height);
 	}
-	
-	vkUnmapMemory(vk->device, dst);
-	return VK_SUCCESS;
+
+	worker_pool_run(workers, copy_row_band, bands, sizeof(struct row_band),
+			band_count);
+}
+
+static VkDeviceSize
+align_up(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
 }
 
 static VkResult
 create_vulkan_image(struct vulkan_ctx *vk, uint32_t width, uint32_t height,
-		VkFormat format, bool disjoint, VkImage *image) {
+		VkFormat format, bool disjoint, bool plane_views, VkImageTiling tiling,
+		VkImage *image) {
 	const VkImageCreateInfo create_info = {
 		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
 		.pNext = NULL,
-		.flags = disjoint ? VK_IMAGE_CREATE_DISJOINT_BIT : 0,
+		/* mutable only when the planes are also viewed on their own */
+		.flags = (plane_views ? VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT : 0)
+			| (disjoint ? VK_IMAGE_CREATE_DISJOINT_BIT : 0),
 		.imageType = VK_IMAGE_TYPE_2D,
 		.format = format,
 		.extent = {
@@ -50,8 +102,10 @@ create_vulkan_image(struct vulkan_ctx *vk, uint32_t width, uint32_t height,
 		.mipLevels = 1,
 		.arrayLayers = 1,
 		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.tiling = VK_IMAGE_TILING_LINEAR,
-		.usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+		.tiling = tiling,
+		.usage = tiling == VK_IMAGE_TILING_OPTIMAL
+			? VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+			: VK_IMAGE_USAGE_SAMPLED_BIT,
 		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
 		.queueFamilyIndexCount = 1,
 		.pQueueFamilyIndices = &vk->queue_family_index,
@@ -62,15 +116,10 @@ create_vulkan_image(struct vulkan_ctx *vk, uint32_t width, uint32_t height,
 
 static VkResult
 allocate_memory_with_requirements(struct vulkan_ctx *vk,
-		VkMemoryRequirements requirements, VkDeviceMemory *memory) {
-	assert(requirements.memoryTypeBits & (1 << vk->host_visible_memory_index));
-	VkMemoryAllocateInfo info = {
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.pNext = NULL,
-		.memoryTypeIndex = vk->host_visible_memory_index,
-		.allocationSize = requirements.size,
-	};
-	return vkAllocateMemory(vk->device, &info, NULL, memory);
+		VkMemoryRequirements requirements, uint32_t memory_index,
+		VkImageTiling tiling, struct memory_allocation *allocation) {
+	return memory_allocator_alloc(&vk->allocator, &requirements, memory_index,
+			tiling == VK_IMAGE_TILING_LINEAR, allocation);
 }
 
 static void
@@ -104,66 +153,460 @@ get_plane_memory_requirements(struct vulkan_ctx *vk, VkImage image,
 	vkGetImageMemoryRequirements2(vk->device, &info, requirements);
 }
 
-static int
-mmap_file(const char *file, size_t size, void **mapped_ptr) {
-	int fd = open(file, O_RDONLY);
-	if (fd == -1) {
-		perror("mmap_file - open");
-		return -1;
+VkResult
+image_uploader_init(struct image_uploader *ini, struct vulkan_ctx *vk,
+		enum image_upload_mode mode, VkDeviceSize staging_size,
+		uint32_t nworkers) {
+	VkResult res;
+
+	ini->mode = mode;
+	ini->stats = (struct image_upload_stats) { 0 };
+	ini->host_import = (struct image_host_import) { 0 };
+	ini->timer = (struct gpu_timer) { 0 };
+	if (worker_pool_init(&ini->workers, nworkers) == -1) {
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	if (mode == IMAGE_UPLOAD_MODE_LINEAR) {
+		return VK_SUCCESS;
+	}
+
+	const VkPhysicalDeviceLimits *limits = &vk->physical_device_properties.limits;
+	/* bufferOffset must also be a multiple of 4 and of the texel size */
+	ini->offset_alignment = limits->optimalBufferCopyOffsetAlignment;
+	if (ini->offset_alignment < 4) {
+		ini->offset_alignment = 4;
+	}
+	ini->row_pitch_alignment = limits->optimalBufferCopyRowPitchAlignment;
+	if (ini->row_pitch_alignment < 1) {
+		ini->row_pitch_alignment = 1;
+	}
+
+	res = vulkan_ctx_create_timeline_semaphore(vk, &ini->timeline, 0);
+	if (res != VK_SUCCESS) {
+		worker_pool_finish(&ini->workers);
+		return res;
+	}
+	ini->submitted = 0;
+
+	res = staging_ring_init(&ini->ring, vk, staging_size, ini->timeline);
+	if (res != VK_SUCCESS) {
+		vkDestroySemaphore(vk->device, ini->timeline, NULL);
+		worker_pool_finish(&ini->workers);
+		return res;
+	}
+
+	res = vulkan_ctx_create_cmd_pool(vk, &ini->cmd_pool,
+			VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+	if (res != VK_SUCCESS) {
+		staging_ring_finish(&ini->ring, vk);
+		vkDestroySemaphore(vk->device, ini->timeline, NULL);
+		worker_pool_finish(&ini->workers);
+		return res;
+	}
+
+	VkCommandBufferAllocateInfo alloc_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandPool = ini->cmd_pool,
+		.commandBufferCount = IMAGE_UPLOADER_MAX_INFLIGHT,
+	};
+	res = vkAllocateCommandBuffers(vk->device, &alloc_info, ini->cmds);
+	if (res != VK_SUCCESS) {
+		vkDestroyCommandPool(vk->device, ini->cmd_pool, NULL);
+		staging_ring_finish(&ini->ring, vk);
+		vkDestroySemaphore(vk->device, ini->timeline, NULL);
+		worker_pool_finish(&ini->workers);
+		return res;
+	}
+	memset(ini->cmd_values, 0, sizeof(ini->cmd_values));
+	ini->next_cmd = 0;
+
+	return VK_SUCCESS;
+}
+
+static uint64_t
+timespec_to_ns(const struct timespec *ts) {
+	return ts->tv_sec * UINT64_C(1000000000) + ts->tv_nsec;
+}
+
+static VkResult
+image_uploader_wait(struct image_uploader *uploader, struct vulkan_ctx *vk,
+		uint64_t value) {
+	TRACE_SCOPE("image_uploader_wait");
+	VkSemaphoreWaitInfo wait_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &uploader->timeline,
+		.pValues = &value,
+	};
+	return vkWaitSemaphores(vk->device, &wait_info, UINT64_MAX);
+}
+
+void
+image_uploader_finish(struct image_uploader *uploader, struct vulkan_ctx *vk) {
+	worker_pool_finish(&uploader->workers);
+	if (uploader->mode == IMAGE_UPLOAD_MODE_LINEAR) {
+		return;
+	}
+
+	image_uploader_release_host(uploader, vk);
+	image_uploader_wait(uploader, vk, uploader->submitted);
+	gpu_timer_collect_all(&uploader->timer, vk);
+	gpu_timer_finish(&uploader->timer, vk);
+
+	vkFreeCommandBuffers(vk->device, uploader->cmd_pool,
+			IMAGE_UPLOADER_MAX_INFLIGHT, uploader->cmds);
+	vkDestroyCommandPool(vk->device, uploader->cmd_pool, NULL);
+	staging_ring_finish(&uploader->ring, vk);
+	vkDestroySemaphore(vk->device, uploader->timeline, NULL);
+}
+
+VkResult
+image_uploader_import_host(struct image_uploader *uploader,
+		struct vulkan_ctx *vk, const void *ptr, size_t size) {
+	if (uploader->mode != IMAGE_UPLOAD_MODE_STAGING) {
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+	}
+	if (!vk->external_memory_host) {
+		return VK_ERROR_EXTENSION_NOT_PRESENT;
+	}
+
+	image_uploader_release_host(uploader, vk);
+
+	/*
+	 * shrink the range to the import alignment, widening it could reach past
+	 * the mapping. frames outside the import go through the staging ring.
+	 */
+	VkDeviceSize alignment = vk->min_imported_host_pointer_alignment;
+	uintptr_t begin = align_up((uintptr_t) ptr, alignment);
+	uintptr_t end = ((uintptr_t) ptr + size) / alignment * alignment;
+	if (end <= begin) {
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+	}
+	VkDeviceSize import_size = end - begin;
+	VkDeviceSize max_size = vk->max_memory_allocation_size / alignment * alignment;
+	if (import_size > max_size) {
+		import_size = max_size;
+	}
+	if (import_size == 0) {
+		return VK_ERROR_FEATURE_NOT_PRESENT;
 	}
 
-	void *out = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
-	if (out == MAP_FAILED) {
-		perror("mmap_file - mmap");
-		return -1;
+	struct image_host_import *import = &uploader->host_import;
+	VkResult res = vulkan_ctx_import_host_buffer(vk, (void *) begin,
+			import_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			&import->buffer, &import->memory);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "image_uploader_import_host - failed to import "
+				"host memory\n");
+		*import = (struct image_host_import) { 0 };
+		return res;
 	}
 
-	*mapped_ptr = out;
-	return 0;
+	import->ptr = (const uint8_t *) begin;
+	import->size = import_size;
+	return VK_SUCCESS;
+}
+
+void
+image_uploader_release_host(struct image_uploader *uploader,
+		struct vulkan_ctx *vk) {
+	struct image_host_import *import = &uploader->host_import;
+	if (import->buffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	image_uploader_wait(uploader, vk, uploader->submitted);
+	vkDestroyBuffer(vk->device, import->buffer, NULL);
+	vkFreeMemory(vk->device, import->memory, NULL);
+	*import = (struct image_host_import) { 0 };
 }
 
 VkResult
-image_init_from_file(struct image *ini, struct vulkan_ctx *vk,
-		const char *file, uint32_t width, uint32_t height,
-		enum image_format format, bool disjoint) {
+image_uploader_enable_timing(struct image_uploader *uploader,
+		struct vulkan_ctx *vk, struct gpu_timings *timings) {
+	if (uploader->mode != IMAGE_UPLOAD_MODE_STAGING) {
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+	}
+	gpu_timer_finish(&uploader->timer, vk);
+	return gpu_timer_init(&uploader->timer, vk, timings, IMAGE_UPLOADER_MAX_INFLIGHT);
+}
+
+/*
+ * a frame can be copied straight from the imported memory when it lies
+ * inside it and every plane starts at an offset vkCmdCopyBufferToImage
+ * accepts, a multiple of 4 and of the texel size.
+ */
+static bool
+can_copy_from_import(struct image *image, struct image_uploader *uploader,
+		const void *mem, VkDeviceSize *base_offset) {
+	const struct image_host_import *import = &uploader->host_import;
+	const uint8_t *frame = mem;
+	size_t frame_size = image_format_size(image->format,
+			image->width, image->height);
+	if (import->buffer == VK_NULL_HANDLE || frame < import->ptr
+			|| frame + frame_size > import->ptr + import->size) {
+		return false;
+	}
+
+	VkDeviceSize offset = frame - import->ptr;
+	for (uint32_t plane = 0; plane < image->plane_count; plane++) {
+		uint32_t plane_width, plane_height;
+		image_format_plane_size(image->format, image->width, image->height,
+				&plane_width, &plane_height, plane);
+		uint32_t texel_size = image_format_plane_texel_size(image->format, plane);
+		if (offset % 4 != 0 || offset % texel_size != 0
+				|| plane_width % texel_size != 0) {
+			return false;
+		}
+		offset += plane_width * plane_height;
+	}
+
+	*base_offset = frame - import->ptr;
+	return true;
+}
+
+/*
+ * fills the staging ring from mem, or uses the imported host memory mem lies
+ * in, then records and submits a copy into the image that leaves it in
+ * VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. the submission is not waited on,
+ * later queue work is ordered by the barriers.
+ */
+static VkResult
+upload_through_staging(struct image *image, struct vulkan_ctx *vk,
+		struct image_uploader *uploader, const void *mem) {
 	VkResult res;
-	size_t size = image_format_size(format, width, height);
 
-	void *mapped_ptr;
-	if (mmap_file(file, size, &mapped_ptr) == -1) {
-		return VK_ERROR_UNKNOWN;
+	/* reuse the oldest command buffer once its previous upload retired */
+	uint32_t cmd_index = uploader->next_cmd;
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	res = image_uploader_wait(uploader, vk, uploader->cmd_values[cmd_index]);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	uploader->stats.wait_ns += timespec_to_ns(&end) - timespec_to_ns(&start);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+	VkCommandBuffer cmd = uploader->cmds[cmd_index];
+
+	VkDeviceSize import_offset;
+	bool zero_copy = can_copy_from_import(image, uploader, mem, &import_offset);
+	VkBuffer src_buffer = zero_copy
+		? uploader->host_import.buffer : uploader->ring.buffer;
+
+	VkBufferImageCopy regions[3];
+	struct image_plane_copy copies[3];
+	size_t mem_offset = 0;
+	uint64_t ring_wait_ns = uploader->ring.wait_ns;
+	for (uint32_t plane = 0; plane < image->plane_count; plane++) {
+		uint32_t plane_width, plane_height;
+		image_format_plane_size(image->format, image->width, image->height,
+				&plane_width, &plane_height, plane);
+		uint32_t texel_size = image_format_plane_texel_size(image->format, plane);
+
+		VkSubresourceLayout staging_layout;
+		if (zero_copy) {
+			/* the frame is copied with the tightly packed layout of the file */
+			staging_layout = (VkSubresourceLayout) {
+				.offset = import_offset + mem_offset,
+				.rowPitch = plane_width,
+				.size = plane_width * plane_height,
+			};
+		} else {
+			staging_layout = (VkSubresourceLayout) {
+				.rowPitch = align_up(plane_width, uploader->row_pitch_alignment),
+			};
+			staging_layout.size = staging_layout.rowPitch * plane_height;
+			res = staging_ring_alloc(&uploader->ring, vk, staging_layout.size,
+					uploader->offset_alignment, &staging_layout.offset);
+			if (res != VK_SUCCESS) {
+				return res;
+			}
+		}
+
+		copies[plane] = (struct image_plane_copy) {
+			.dst = uploader->ring.mapped_ptr,
+			.layout = staging_layout,
+			.width = plane_width,
+			.height = plane_height,
+			.data = (const uint8_t *) mem + mem_offset,
+		};
+		mem_offset += plane_width * plane_height;
+
+		regions[plane] = (VkBufferImageCopy) {
+			.bufferOffset = staging_layout.offset,
+			.bufferRowLength = staging_layout.rowPitch / texel_size,
+			.bufferImageHeight = 0,
+			.imageSubresource = {
+				.aspectMask = plane_aspects[plane],
+				.mipLevel = 0,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+			.imageOffset = { 0, 0, 0 },
+			.imageExtent = {
+				.width = plane_width / texel_size,
+				.height = plane_height,
+				.depth = 1,
+			},
+		};
+	}
+
+	uploader->stats.wait_ns += uploader->ring.wait_ns - ring_wait_ns;
+
+	if (zero_copy) {
+		uploader->stats.zero_copy++;
+	} else {
+		image_copy_to_memory(&uploader->workers, copies, image->plane_count);
 	}
 
-	res = image_init_from_memory(ini, vk, mapped_ptr,
-			width, height, format, disjoint);
+	res = vkResetCommandBuffer(cmd, 0);
 	if (res != VK_SUCCESS) {
 		return res;
 	}
 
-	if (munmap(mapped_ptr, size) == -1) {
-		perror("image_init_from_file - munmap");
-		return VK_ERROR_UNKNOWN;
+	VkCommandBufferBeginInfo begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	};
+	res = vkBeginCommandBuffer(cmd, &begin_info);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	/* the previous upload of this command buffer retired above */
+	struct gpu_timer *timer = &uploader->timer;
+	gpu_timer_reset(timer, vk, cmd, cmd_index);
+
+	VkImageMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.oldLayout = image->layout,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image->vk_image,
+		.subresourceRange = (VkImageSubresourceRange) {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+	/* previous frames may still be sampling this image, or converting it */
+	vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, NULL,
+			0, NULL,
+			1, &barrier);
+
+	gpu_timer_begin(timer, cmd, cmd_index, GPU_STAGE_UPLOAD_COPY,
+			VK_PIPELINE_STAGE_TRANSFER_BIT);
+	vkCmdCopyBufferToImage(cmd, src_buffer, image->vk_image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, image->plane_count, regions);
+	gpu_timer_end(timer, cmd, cmd_index, GPU_STAGE_UPLOAD_COPY,
+			VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+	/* the transition into the layout for sampling */
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			0, NULL,
+			0, NULL,
+			1, &barrier);
+
+	res = vkEndCommandBuffer(cmd);
+	if (res != VK_SUCCESS) {
+		return res;
 	}
 
+	uint64_t signal_value = uploader->submitted + 1;
+	VkTimelineSemaphoreSubmitInfo timeline_info = {
+		.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		.signalSemaphoreValueCount = 1,
+		.pSignalSemaphoreValues = &signal_value,
+	};
+	VkSubmitInfo submit_info = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = &timeline_info,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &cmd,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &uploader->timeline,
+	};
+	res = vkQueueSubmit(vk->queue, 1, &submit_info, VK_NULL_HANDLE);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	uploader->submitted = signal_value;
+	uploader->cmd_values[cmd_index] = signal_value;
+	uploader->next_cmd = (cmd_index + 1) % IMAGE_UPLOADER_MAX_INFLIGHT;
+	if (!zero_copy) {
+		staging_ring_submit(&uploader->ring, signal_value);
+	}
+
+	image->layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	return VK_SUCCESS;
 }
 
 VkResult
-image_init_from_memory(struct image *ini, struct vulkan_ctx *vk,
-		void *mem, uint32_t width, uint32_t height,
-		enum image_format format, bool disjoint) {
-	static const VkImageAspectFlagBits plane_aspects[3] = {
-		VK_IMAGE_ASPECT_PLANE_0_BIT,
-		VK_IMAGE_ASPECT_PLANE_1_BIT,
-		VK_IMAGE_ASPECT_PLANE_2_BIT,
-	};
+image_init_from_file(struct image *ini, struct vulkan_ctx *vk,
+		struct image_uploader *uploader, const char *file,
+		uint32_t width, uint32_t height, enum image_format format,
+		bool disjoint, enum image_conversion conversion) {
+	VkResult res;
+
+	struct sequence sequence;
+	if (sequence_open(&sequence, file, width, height, format) == -1) {
+		return VK_ERROR_UNKNOWN;
+	}
+
+	/* the copy can come straight from the mapping, unless one is in use */
+	bool imported = false;
+	if (uploader->mode == IMAGE_UPLOAD_MODE_STAGING && vk->external_memory_host
+			&& uploader->host_import.buffer == VK_NULL_HANDLE) {
+		imported = image_uploader_import_host(uploader, vk,
+				sequence.mapped_ptr, sequence.mapped_size) == VK_SUCCESS;
+	}
 
+	res = image_init_from_memory(ini, vk, uploader,
+			sequence_frame(&sequence, 0), sequence.width, sequence.height,
+			sequence.format, disjoint, conversion);
+	if (imported) {
+		image_uploader_release_host(uploader, vk);
+	}
+	sequence_close(&sequence);
+	return res;
+}
+
+VkResult
+image_init_from_memory(struct image *ini, struct vulkan_ctx *vk,
+		struct image_uploader *uploader, const void *mem,
+		uint32_t width, uint32_t height, enum image_format format,
+		bool disjoint, enum image_conversion conversion) {
 	VkResult res;
 	uint32_t plane_count = image_format_plane_count(format);
 
+	/* optimal images are only reachable through a staging copy */
+	VkImageTiling tiling = VK_IMAGE_TILING_LINEAR;
+	uint32_t memory_index = vk->host_visible_memory_index;
+	if (uploader->mode == IMAGE_UPLOAD_MODE_STAGING) {
+		tiling = VK_IMAGE_TILING_OPTIMAL;
+		memory_index = vk->device_local_memory_index;
+	}
+
 	VkImage image;
+	/* the compute conversion reads every plane through a view of its own */
 	res = create_vulkan_image(vk, width, height,
-			image_format_to_vk_format(format), disjoint, &image);
+			image_format_to_vk_format(format), disjoint,
+			conversion == IMAGE_CONVERSION_COMPUTE, tiling, &image);
 	if (res != VK_SUCCESS) {
 		fprintf(stderr, "image_init_from_memory - failed to create_vulkan_image\n");
 		return res;
@@ -171,35 +614,18 @@ image_init_from_memory(struct image *ini, struct vulkan_ctx *vk,
 
 	VkBindImageMemoryInfo bind_infos[3];
 	VkBindImagePlaneMemoryInfo bind_plane_infos[3];
-	VkDeviceMemory memories[3];
+	struct memory_allocation allocations[3] = { 0 };
 	VkMemoryRequirements2 requirements;
-	VkImageSubresource subresource = {
-		.arrayLayer = 0,
-		.mipLevel = 0,
-	};
-	VkSubresourceLayout subresource_layout;
+	uint32_t memory_count;
 	if (disjoint) {
-		size_t mem_offset = 0;
 		for (uint32_t plane = 0; plane < plane_count; plane++) {
 			get_plane_memory_requirements(vk, image,
 					plane_aspects[plane], &requirements);
 			res = allocate_memory_with_requirements(vk,
-					requirements.memoryRequirements, &memories[plane]);
-			assert(res == VK_SUCCESS);
-
-			uint32_t plane_width, plane_height;
-			image_format_plane_size(format, width, height,
-					&plane_width, &plane_height, plane);
-
-			subresource.aspectMask = plane_aspects[plane];
-			vkGetImageSubresourceLayout(vk->device, image, &subresource,
-					&subresource_layout);
-			res = copy_to_memory(vk, memories[plane], &subresource_layout,
-					plane_width, plane_height, mem + mem_offset);
+					requirements.memoryRequirements, memory_index, tiling,
+					&allocations[plane]);
 			assert(res == VK_SUCCESS);
 
-			mem_offset += plane_width * plane_height;
-
 			bind_plane_infos[plane] = (const VkBindImagePlaneMemoryInfo) {
 				.sType = VK_STRUCTURE_TYPE_BIND_IMAGE_PLANE_MEMORY_INFO,
 				.pNext = NULL,
@@ -209,85 +635,166 @@ image_init_from_memory(struct image *ini, struct vulkan_ctx *vk,
 				.sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_INFO,
 				.pNext = &bind_plane_infos[plane],
 				.image = image,
-				.memory = memories[plane],
-				.memoryOffset = 0,
+				.memory = allocations[plane].memory,
+				.memoryOffset = allocations[plane].offset,
 			};
 		}
+		memory_count = plane_count;
 	} else {
 		get_image_memory_requirements(vk, image, &requirements);
 		res = allocate_memory_with_requirements(vk,
-				requirements.memoryRequirements, &memories[0]);
+				requirements.memoryRequirements, memory_index, tiling,
+				&allocations[0]);
 		assert(res == VK_SUCCESS);
 
-		size_t mem_offset = 0;
-		for (uint32_t plane = 0; plane < plane_count; plane++) {
-			uint32_t plane_width, plane_height;
-			image_format_plane_size(format, width, height,
-					&plane_width, &plane_height, plane);
-
-			subresource.aspectMask = plane_aspects[plane];
-			vkGetImageSubresourceLayout(vk->device, image, &subresource,
-					&subresource_layout);
-			res = copy_to_memory(vk, memories[0], &subresource_layout,
-					plane_width, plane_height, mem + mem_offset);
-			assert(res == VK_SUCCESS);
-
-			mem_offset += plane_width * plane_height;
-		}
-
 		bind_infos[0] = (const VkBindImageMemoryInfo) {
 			.sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_INFO,
 			.pNext = NULL,
 			.image = image,
-			.memory = memories[0],
-			.memoryOffset = 0,
+			.memory = allocations[0].memory,
+			.memoryOffset = allocations[0].offset,
 		};
-
-		plane_count = 1;
+		memory_count = 1;
 	}
 
-	res = vkBindImageMemory2(vk->device, plane_count, bind_infos);
+	res = vkBindImageMemory2(vk->device, memory_count, bind_infos);
 	if (res != VK_SUCCESS) {
 		return res;
 	}
 
+	/* linear images are written through the allocator's persistent mapping */
+	VkSubresourceLayout plane_layouts[3] = { 0 };
+	if (tiling == VK_IMAGE_TILING_LINEAR) {
+		VkImageSubresource subresource = {
+			.arrayLayer = 0,
+			.mipLevel = 0,
+		};
+		for (uint32_t plane = 0; plane < plane_count; plane++) {
+			subresource.aspectMask = plane_aspects[plane];
+			vkGetImageSubresourceLayout(vk->device, image, &subresource,
+					&plane_layouts[plane]);
+		}
+	}
+
 	ini->width = width;
 	ini->height = height;
 	ini->format = format;
 	ini->plane_count = plane_count;
+	ini->disjoint = disjoint;
+	ini->tiling = tiling;
+	ini->layout = VK_IMAGE_LAYOUT_UNDEFINED;
 	ini->vk_image = image;
-	memcpy(ini->vk_memories, memories, sizeof(ini->vk_memories));
+	ini->memory_count = memory_count;
+	memcpy(ini->allocations, allocations, sizeof(ini->allocations));
+	memcpy(ini->plane_layouts, plane_layouts, sizeof(ini->plane_layouts));
+
+	return image_upload(ini, vk, uploader, mem);
+}
 
+static VkResult
+upload_linear(struct image *image, struct image_uploader *uploader,
+		const void *mem) {
+	struct image_plane_copy copies[3];
+	size_t mem_offset = 0;
+	for (uint32_t plane = 0; plane < image->plane_count; plane++) {
+		uint32_t plane_width, plane_height;
+		image_format_plane_size(image->format, image->width, image->height,
+				&plane_width, &plane_height, plane);
+
+		copies[plane] = (struct image_plane_copy) {
+			.dst = image->allocations[image->disjoint ? plane : 0].mapped_ptr,
+			.layout = image->plane_layouts[plane],
+			.width = plane_width,
+			.height = plane_height,
+			.data = (const uint8_t *) mem + mem_offset,
+		};
+		mem_offset += plane_width * plane_height;
+	}
+
+	image_copy_to_memory(&uploader->workers, copies, image->plane_count);
 	return VK_SUCCESS;
 }
 
+VkResult
+image_upload(struct image *image, struct vulkan_ctx *vk,
+		struct image_uploader *uploader, const void *mem) {
+	VkResult res;
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	if (image->tiling == VK_IMAGE_TILING_OPTIMAL) {
+		assert(uploader->mode == IMAGE_UPLOAD_MODE_STAGING);
+		res = upload_through_staging(image, vk, uploader, mem);
+	} else {
+		res = upload_linear(image, uploader, mem);
+	}
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	uint64_t elapsed = timespec_to_ns(&end) - timespec_to_ns(&start);
+
+	struct image_upload_stats *stats = &uploader->stats;
+	stats->count++;
+	stats->total_ns += elapsed;
+	if (elapsed > stats->max_ns) {
+		stats->max_ns = elapsed;
+	}
+	return res;
+}
+
 void
 image_finish(struct image *image, struct vulkan_ctx *vk) {
 	vkDestroyImage(vk->device, image->vk_image, NULL);
 
-	for (uint32_t plane = 0; plane < image->plane_count; plane++) {
-		vkFreeMemory(vk->device, image->vk_memories[plane], NULL);
+	for (uint32_t memory = 0; memory < image->memory_count; memory++) {
+		memory_allocator_free(&vk->allocator, &image->allocations[memory]);
+	}
+}
+
+static VkSamplerYcbcrModelConversion
+color_model_to_vk(enum image_color_model model) {
+	switch (model) {
+		case IMAGE_COLOR_MODEL_BT601:
+			return VK_SAMPLER_YCBCR_MODEL_CONVERSION_YCBCR_601;
+		case IMAGE_COLOR_MODEL_BT709:
+			return VK_SAMPLER_YCBCR_MODEL_CONVERSION_YCBCR_709;
+		case IMAGE_COLOR_MODEL_BT2020:
+			return VK_SAMPLER_YCBCR_MODEL_CONVERSION_YCBCR_2020;
 	}
+	return VK_SAMPLER_YCBCR_MODEL_CONVERSION_YCBCR_709;
 }
 
 VkResult image_sampler_init(struct image_sampler *ini, struct vulkan_ctx *vk,
-		enum image_format format) {
+		enum image_format format, enum image_conversion mode,
+		enum image_color_model model, enum image_color_range range,
+		VkFilter filter) {
 	VkResult res;
 
-	VkSamplerYcbcrConversion ycbcr_conversion;
+	ini->format = format;
+	ini->mode = mode;
+	ini->model = model;
+	ini->range = range;
+
+	VkSamplerYcbcrConversion ycbcr_conversion = VK_NULL_HANDLE;
 	VkSamplerYcbcrConversionCreateInfo ycbcr_conversion_create = {
 		.sType = VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_CREATE_INFO,
 		.format = image_format_to_vk_format(format),
-		.ycbcrModel = VK_SAMPLER_YCBCR_MODEL_CONVERSION_YCBCR_709,
-		.ycbcrRange = VK_SAMPLER_YCBCR_RANGE_ITU_FULL,
+		.ycbcrModel = color_model_to_vk(model),
+		.ycbcrRange = range == IMAGE_COLOR_RANGE_LIMITED
+			? VK_SAMPLER_YCBCR_RANGE_ITU_NARROW : VK_SAMPLER_YCBCR_RANGE_ITU_FULL,
 		.xChromaOffset = VK_CHROMA_LOCATION_MIDPOINT,
 		.yChromaOffset = VK_CHROMA_LOCATION_MIDPOINT,
-		.chromaFilter = VK_FILTER_NEAREST,
+		/* without separate reconstruction filters, these must match the sampler's */
+		.chromaFilter = filter,
 	};
-	res = vkCreateSamplerYcbcrConversion(vk->device, &ycbcr_conversion_create,
-			NULL, &ycbcr_conversion);
-	if (res != VK_SUCCESS) {
-		return res;
+	/* the compute shader does the conversion itself and only fetches texels */
+	if (mode == IMAGE_CONVERSION_SAMPLER) {
+		res = vkCreateSamplerYcbcrConversion(vk->device, &ycbcr_conversion_create,
+				NULL, &ycbcr_conversion);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
 	}
 
 	VkSampler sampler;
@@ -297,9 +804,9 @@ VkResult image_sampler_init(struct image_sampler *ini, struct vulkan_ctx *vk,
 	};
 	VkSamplerCreateInfo sampler_create = {
 		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-		.pNext = &ycbcr_info,
-		.magFilter = VK_FILTER_NEAREST,
-		.minFilter = VK_FILTER_NEAREST,
+		.pNext = mode == IMAGE_CONVERSION_SAMPLER ? &ycbcr_info : NULL,
+		.magFilter = filter,
+		.minFilter = filter,
 		.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
 		.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
 		.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
@@ -317,7 +824,6 @@ VkResult image_sampler_init(struct image_sampler *ini, struct vulkan_ctx *vk,
 		return res;
 	}
 
-	ini->format = format;
 	ini->conversion = ycbcr_conversion;
 	ini->sampler = sampler;
 	return VK_SUCCESS;
@@ -0,0 +1,256 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "image_pool.h"
+
+static VkResult
+create_image_view(struct vulkan_ctx *vk, VkImageView *image_view,
+		const struct image *image, const struct image_sampler *sampler) {
+	VkSamplerYcbcrConversionInfo conversion_info = {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_INFO,
+		.pNext = NULL,
+		.conversion = sampler->conversion,
+	};
+	VkImageViewCreateInfo image_view_create = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.pNext = &conversion_info,
+		.image = image->vk_image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = image_format_to_vk_format(image->format),
+		.components = {
+			.r = VK_COMPONENT_SWIZZLE_R,
+			.g = VK_COMPONENT_SWIZZLE_G,
+			.b = VK_COMPONENT_SWIZZLE_B,
+			.a = VK_COMPONENT_SWIZZLE_A,
+		},
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+	return vkCreateImageView(vk->device, &image_view_create, NULL, image_view);
+}
+
+static VkResult
+create_plane_view(struct vulkan_ctx *vk, VkImageView *image_view,
+		const struct image *image, uint32_t plane) {
+	VkImageViewCreateInfo image_view_create = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image = image->vk_image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = image_format_plane_vk_format(image->format, plane),
+		.components = {
+			.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+		},
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_PLANE_0_BIT << plane,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+	return vkCreateImageView(vk->device, &image_view_create, NULL, image_view);
+}
+
+static void
+destroy_views(struct vulkan_ctx *vk, struct pooled_image *image) {
+	vkDestroyImageView(vk->device, image->view, NULL);
+	for (uint32_t plane = 0; plane < 3; plane++) {
+		vkDestroyImageView(vk->device, image->plane_views[plane], NULL);
+	}
+}
+
+static VkResult
+create_views(struct vulkan_ctx *vk, struct pooled_image *image,
+		const struct image_sampler *sampler) {
+	if (sampler->mode == IMAGE_CONVERSION_SAMPLER) {
+		return create_image_view(vk, &image->view, &image->image, sampler);
+	}
+
+	for (uint32_t plane = 0; plane < image->image.plane_count; plane++) {
+		VkResult res = create_plane_view(vk, &image->plane_views[plane],
+				&image->image, plane);
+		if (res != VK_SUCCESS) {
+			destroy_views(vk, image);
+			return res;
+		}
+	}
+	return VK_SUCCESS;
+}
+
+static bool
+key_equal(const struct image_pool_key *a, const struct image_pool_key *b) {
+	return a->format == b->format && a->width == b->width
+		&& a->height == b->height && a->disjoint == b->disjoint;
+}
+
+void
+image_pool_init(struct image_pool *ini, VkDeviceSize idle_budget) {
+	ini->idle_budget = idle_budget;
+	ini->idle_bytes = 0;
+	ini->tick = 0;
+	ini->count = 0;
+	ini->capacity = 0;
+	ini->images = NULL;
+	ini->stats = (struct image_pool_stats) { 0 };
+}
+
+static void
+destroy_pooled_image(struct vulkan_ctx *vk, struct pooled_image *image) {
+	destroy_views(vk, image);
+	image_finish(&image->image, vk);
+	free(image);
+}
+
+void
+image_pool_finish(struct image_pool *pool, struct vulkan_ctx *vk) {
+	for (uint32_t i = 0; i < pool->count; i++) {
+		if (pool->images[i]->in_use) {
+			fprintf(stderr, "image_pool_finish - image still in use\n");
+		}
+		destroy_pooled_image(vk, pool->images[i]);
+	}
+
+	free(pool->images);
+	pool->images = NULL;
+	pool->count = 0;
+	pool->capacity = 0;
+	pool->idle_bytes = 0;
+}
+
+/* the most recently released idle image with key, its memory is warmest */
+static struct pooled_image *
+find_idle(struct image_pool *pool, const struct image_pool_key *key) {
+	struct pooled_image *found = NULL;
+	for (uint32_t i = 0; i < pool->count; i++) {
+		struct pooled_image *image = pool->images[i];
+		if (!image->in_use && key_equal(&image->key, key)
+				&& (found == NULL || image->released_at > found->released_at)) {
+			found = image;
+		}
+	}
+	return found;
+}
+
+static VkResult
+create_pooled_image(struct image_pool *pool, struct vulkan_ctx *vk,
+		struct image_uploader *uploader, const struct image_sampler *sampler,
+		const void *mem, const struct image_pool_key *key,
+		struct pooled_image **out) {
+	VkResult res;
+
+	if (pool->count == pool->capacity) {
+		uint32_t capacity = pool->capacity > 0 ? pool->capacity * 2 : 8;
+		struct pooled_image **images = realloc(pool->images,
+				capacity * sizeof(struct pooled_image *));
+		if (images == NULL) {
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+		}
+		pool->images = images;
+		pool->capacity = capacity;
+	}
+
+	struct pooled_image *image = calloc(1, sizeof(struct pooled_image));
+	if (image == NULL) {
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	res = image_init_from_memory(&image->image, vk, uploader, mem,
+			key->width, key->height, key->format, key->disjoint, sampler->mode);
+	if (res != VK_SUCCESS) {
+		free(image);
+		return res;
+	}
+
+	res = create_views(vk, image, sampler);
+	if (res != VK_SUCCESS) {
+		image_finish(&image->image, vk);
+		free(image);
+		return res;
+	}
+
+	image->key = *key;
+	for (uint32_t memory = 0; memory < image->image.memory_count; memory++) {
+		image->size += image->image.allocations[memory].size;
+	}
+
+	pool->images[pool->count++] = image;
+	*out = image;
+	return VK_SUCCESS;
+}
+
+VkResult
+image_pool_acquire(struct image_pool *pool, struct vulkan_ctx *vk,
+		struct image_uploader *uploader, const struct image_sampler *sampler,
+		const void *mem, uint32_t width, uint32_t height,
+		enum image_format format, bool disjoint, struct pooled_image **out) {
+	VkResult res;
+	assert(sampler->format == format);
+
+	struct image_pool_key key = {
+		.format = format,
+		.width = width,
+		.height = height,
+		.disjoint = disjoint,
+	};
+
+	struct pooled_image *image = find_idle(pool, &key);
+	if (image != NULL) {
+		res = image_upload(&image->image, vk, uploader, mem);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+		pool->idle_bytes -= image->size;
+		pool->stats.hits++;
+	} else {
+		res = create_pooled_image(pool, vk, uploader, sampler, mem, &key, &image);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+		pool->stats.misses++;
+	}
+
+	image->in_use = true;
+	*out = image;
+	return VK_SUCCESS;
+}
+
+static void
+evict_idle(struct image_pool *pool, struct vulkan_ctx *vk) {
+	while (pool->idle_bytes > pool->idle_budget) {
+		uint32_t oldest = pool->count;
+		for (uint32_t i = 0; i < pool->count; i++) {
+			struct pooled_image *image = pool->images[i];
+			if (!image->in_use && (oldest == pool->count
+						|| image->released_at < pool->images[oldest]->released_at)) {
+				oldest = i;
+			}
+		}
+		assert(oldest < pool->count);
+
+		struct pooled_image *image = pool->images[oldest];
+		pool->idle_bytes -= image->size;
+		pool->images[oldest] = pool->images[--pool->count];
+		destroy_pooled_image(vk, image);
+		pool->stats.evictions++;
+	}
+}
+
+void
+image_pool_release(struct image_pool *pool, struct vulkan_ctx *vk,
+		struct pooled_image *image) {
+	assert(image->in_use);
+	image->in_use = false;
+	image->released_at = ++pool->tick;
+	pool->idle_bytes += image->size;
+
+	evict_idle(pool, vk);
+}
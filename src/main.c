@@ -1,14 +1,33 @@
 #include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "image.h"
+#include "image_pool.h"
+#include "pacer.h"
 #include "pipeline.h"
+#include "readahead.h"
+#include "sequence.h"
+#include "trace.h"
+#include "wall.h"
 #include "window.h"
+#include "worker_pool.h"
 
 #define RENDER_FORMAT VK_FORMAT_B8G8R8A8_UNORM
+#define MAX_FRAME_SLOTS 8
+#define MAX_FRAMES_IN_FLIGHT 4
+/* more swapchain images than this only add latency */
+#define MAX_SWAPCHAIN_IMAGES 8
+/* upper bound on blocking for a present to reach the display */
+#define PRESENT_WAIT_TIMEOUT_NS UINT64_C(50000000)
 
 static VkResult
 create_command_buffer(struct vulkan_ctx *vk, VkCommandPool pool,
@@ -22,18 +41,24 @@ create_command_buffer(struct vulkan_ctx *vk, VkCommandPool pool,
 	return vkAllocateCommandBuffers(vk->device, &info, cmd_buffer);
 }
 
+/*
+ * final_layout is what the image is left in for presenting, or reading back.
+ * the old contents are dropped rather than cleared, whatever the draw doesn't
+ * cover is cleared explicitly.
+ */
 static VkResult
-create_renderpass(struct vulkan_ctx *vk, VkRenderPass *render_pass) {
+create_renderpass(struct vulkan_ctx *vk, VkRenderPass *render_pass,
+		VkImageLayout final_layout) {
 	VkAttachmentDescription attachment_desc = {
 		.flags = 0,
 		.format = RENDER_FORMAT,
 		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+		.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
 		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		.finalLayout = final_layout,
 	};
 
 	VkAttachmentReference color_attachment = {
@@ -67,18 +92,40 @@ create_renderpass(struct vulkan_ctx *vk, VkRenderPass *render_pass) {
 	return vkCreateRenderPass(vk->device, &create, NULL, render_pass);
 }
 
+/*
+ * a set per slot drawing its tiles, and with compute conversion another one
+ * per tile of every slot for it
+ */
 static VkResult
-create_descriptor_pool(struct vulkan_ctx *vk, VkDescriptorPool *descriptor_pool) {
+create_descriptor_pool(struct vulkan_ctx *vk, VkDescriptorPool *descriptor_pool,
+		uint32_t nslots, uint32_t ntiles, bool compute) {
+	bool wall = ntiles > 1;
+	VkDescriptorPoolSize sizes[3] = {
+		{
+			.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = nslots * (wall ? WALL_MAX_TILES : 1)
+				+ (compute ? 3 * nslots * ntiles : 0),
+		},
+	};
+	uint32_t nsizes = 1;
+	if (compute) {
+		sizes[nsizes++] = (VkDescriptorPoolSize) {
+			.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			.descriptorCount = nslots * ntiles,
+		};
+	}
+	if (wall) {
+		sizes[nsizes++] = (VkDescriptorPoolSize) {
+			.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = nslots,
+		};
+	}
+
 	VkDescriptorPoolCreateInfo create_info = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-		.poolSizeCount = 1,
-		.pPoolSizes = (VkDescriptorPoolSize[]) {
-			{
-				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				.descriptorCount = 1,
-			},
-		},
-		.maxSets = 1,
+		.poolSizeCount = nsizes,
+		.pPoolSizes = sizes,
+		.maxSets = nslots + (compute ? nslots * ntiles : 0),
 	};
 	return vkCreateDescriptorPool(vk->device, &create_info, NULL, descriptor_pool);
 }
@@ -114,37 +161,6 @@ allocate_descriptor_set(struct vulkan_ctx *vk, VkDescriptorSet *set,
 	return vkAllocateDescriptorSets(vk->device, &alloc_info, set);
 }
 
-static VkResult
-create_image_view(struct vulkan_ctx *vk, VkImageView *image_view,
-		const struct image *image, const struct image_sampler *sampler) {
-	VkSamplerYcbcrConversionInfo conversion_info = {
-		.sType = VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_INFO,
-		.pNext = NULL,
-		.conversion = sampler->conversion,
-	};
-	VkImageViewCreateInfo image_view_create = {
-		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-		.pNext = &conversion_info,
-		.image = image->vk_image,
-		.viewType = VK_IMAGE_VIEW_TYPE_2D,
-		.format = image_format_to_vk_format(image->format),
-		.components = {
-			.r = VK_COMPONENT_SWIZZLE_R,
-			.g = VK_COMPONENT_SWIZZLE_G,
-			.b = VK_COMPONENT_SWIZZLE_B,
-			.a = VK_COMPONENT_SWIZZLE_A,
-		},
-		.subresourceRange = {
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1,
-		},
-	};
-	return vkCreateImageView(vk->device, &image_view_create, NULL, image_view);
-}
-
 static VkResult
 transition_image_layout(struct vulkan_ctx *vk, VkCommandPool cmd_pool,
 		VkImage image) {
@@ -182,8 +198,8 @@ transition_image_layout(struct vulkan_ctx *vk, VkCommandPool cmd_pool,
 			.layerCount = 1,
 		},
 	};
-	vkCmdPipelineBarrier(temp_buf,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+	vkCmdPipelineBarrier(temp_buf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
 			0, NULL,
 			0, NULL,
 			1, &image_memory_barrier);
@@ -211,18 +227,19 @@ transition_image_layout(struct vulkan_ctx *vk, VkCommandPool cmd_pool,
 
 static void
 update_descriptor_with_image(struct vulkan_ctx *vk, VkDescriptorSet descriptor,
-		VkSampler sampler, VkImageView image_view) {
+		uint32_t binding, VkDescriptorType type, VkSampler sampler,
+		VkImageView image_view, VkImageLayout layout) {
 	VkWriteDescriptorSet descriptor_write = {
 		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
 		.dstSet = descriptor,
-		.dstBinding = 0,
+		.dstBinding = binding,
 		.dstArrayElement = 0,
 		.descriptorCount = 1,
-		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.descriptorType = type,
 		.pImageInfo = &(VkDescriptorImageInfo) {
 				.sampler = sampler,
 				.imageView = image_view,
-				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.imageLayout = layout,
 		},
 	};
 	vkUpdateDescriptorSets(vk->device, 1, &descriptor_write, 0, NULL);
@@ -232,11 +249,25 @@ struct swapchain_image {
 	VkImage image;
 	VkImageView image_view;
 	VkFramebuffer framebuffer;
+	/* backs image if it is an offscreen target */
+	struct memory_allocation allocation;
+
+	/* signalled by the rendering of this image, waited on by its present */
+	VkSemaphore rendering_semaphore;
+	/* fence of the frame that last rendered into this image, if any */
+	VkFence inflight_fence;
 };
 
 struct swapchain {
+	/* what was asked for, negotiated against the surface on every creation */
+	VkPresentModeKHR requested_present_mode;
+	uint32_t requested_nimages;
+
+	/* the images are offscreen targets owned by the app, there is no vk_swapchain */
+	bool offscreen;
 	VkSwapchainKHR vk_swapchain;
 	VkExtent2D extent;
+	VkPresentModeKHR present_mode;
 
 	uint32_t nimages;
 	struct swapchain_image *images;
@@ -249,20 +280,134 @@ destroy_swapchain_related_resources(struct vulkan_ctx *vk, struct swapchain *swa
 		swapchain->images[i].image_view = NULL;
 		vkDestroyFramebuffer(vk->device, swapchain->images[i].framebuffer, NULL);
 		swapchain->images[i].framebuffer = NULL;
+		vkDestroySemaphore(vk->device, swapchain->images[i].rendering_semaphore, NULL);
+		swapchain->images[i].rendering_semaphore = NULL;
+		if (swapchain->offscreen) {
+			vkDestroyImage(vk->device, swapchain->images[i].image, NULL);
+			memory_allocator_free(&vk->allocator, &swapchain->images[i].allocation);
+		}
 	}
 	swapchain->nimages = 0;
 	free(swapchain->images);
 	swapchain->images = NULL;
 }
 
+/* creates the view and framebuffer rendering into vk_image */
+static VkResult
+init_swapchain_image(struct vulkan_ctx *vk, VkRenderPass render_pass,
+		VkExtent2D extent, VkImage vk_image,
+		struct swapchain_image *swapchain_image) {
+	VkResult res;
+
+	VkImageViewCreateInfo image_view_create = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.flags = 0,
+		.image = vk_image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = RENDER_FORMAT,
+		.components = {
+			.r = VK_COMPONENT_SWIZZLE_R,
+			.g = VK_COMPONENT_SWIZZLE_G,
+			.b = VK_COMPONENT_SWIZZLE_B,
+			.a = VK_COMPONENT_SWIZZLE_A,
+		},
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+	VkImageView image_view;
+	res = vkCreateImageView(vk->device, &image_view_create, NULL, &image_view);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	VkFramebufferCreateInfo framebuffer_create = {
+		.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+		.renderPass = render_pass,
+		.attachmentCount = 1,
+		.pAttachments = &image_view,
+		.width = extent.width,
+		.height = extent.height,
+		.layers = 1,
+	};
+	VkFramebuffer framebuffer;
+	res = vkCreateFramebuffer(vk->device, &framebuffer_create, NULL, &framebuffer);
+	if (res != VK_SUCCESS) {
+		vkDestroyImageView(vk->device, image_view, NULL);
+		return res;
+	}
+
+	swapchain_image->image = vk_image;
+	swapchain_image->image_view = image_view;
+	swapchain_image->framebuffer = framebuffer;
+	swapchain_image->inflight_fence = VK_NULL_HANDLE;
+	return VK_SUCCESS;
+}
+
+static const char *
+present_mode_name(VkPresentModeKHR present_mode) {
+	switch (present_mode) {
+		case VK_PRESENT_MODE_IMMEDIATE_KHR:
+			return "immediate";
+		case VK_PRESENT_MODE_MAILBOX_KHR:
+			return "mailbox";
+		case VK_PRESENT_MODE_FIFO_KHR:
+			return "fifo";
+		case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+			return "fifo_relaxed";
+		default:
+			return "unknown";
+	}
+}
+
+/*
+ * the requested mode if the surface supports it, otherwise the closest one
+ * that still doesn't tear, or tears least. fifo is always supported.
+ */
+static VkPresentModeKHR
+choose_present_mode(struct vulkan_ctx *vk, VkSurfaceKHR surface,
+		VkPresentModeKHR requested) {
+	uint32_t nmodes = 8;
+	VkPresentModeKHR modes[8];
+	VkResult res = vkGetPhysicalDeviceSurfacePresentModesKHR(vk->physical_device,
+			surface, &nmodes, modes);
+	if (res != VK_SUCCESS && res != VK_INCOMPLETE) {
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+
+	VkPresentModeKHR fallbacks[3] = { requested };
+	uint32_t nfallbacks = 1;
+	if (requested == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+		fallbacks[nfallbacks++] = VK_PRESENT_MODE_MAILBOX_KHR;
+	} else if (requested == VK_PRESENT_MODE_MAILBOX_KHR) {
+		fallbacks[nfallbacks++] = VK_PRESENT_MODE_IMMEDIATE_KHR;
+	}
+
+	for (uint32_t i = 0; i < nfallbacks; i++) {
+		for (uint32_t mode = 0; mode < nmodes; mode++) {
+			if (modes[mode] == fallbacks[i]) {
+				return fallbacks[i];
+			}
+		}
+	}
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+/*
+ * points swapchain at a new handle and images. a previous swapchain is passed
+ * on as oldSwapchain, and left with its images for the caller to destroy once
+ * no frame uses them anymore.
+ */
 static VkResult
 create_swapchain(struct vulkan_ctx *vk, VkSurfaceKHR surface,
 		VkRenderPass render_pass, struct swapchain *swapchain) {
+	TRACE_SCOPE("create_swapchain");
 	VkResult res = VK_SUCCESS;
 
-	res = vkDeviceWaitIdle(vk->device);
-	assert(res == VK_SUCCESS);
-
 	uint32_t nformats = 16;
 	VkSurfaceFormatKHR surface_formats[16];
 	res = vkGetPhysicalDeviceSurfaceFormatsKHR(vk->physical_device,
@@ -275,12 +420,28 @@ create_swapchain(struct vulkan_ctx *vk, VkSurfaceKHR surface,
 	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vk->physical_device, surface,
 			&surface_caps);
 
-	destroy_swapchain_related_resources(vk, swapchain);
+	VkPresentModeKHR present_mode = choose_present_mode(vk, surface,
+			swapchain->requested_present_mode);
+	if (present_mode != swapchain->requested_present_mode
+			&& present_mode != swapchain->present_mode) {
+		fprintf(stderr, "create_swapchain - %s present mode not supported... "
+				"using %s\n", present_mode_name(swapchain->requested_present_mode),
+				present_mode_name(present_mode));
+	}
+
+	/* 0 asks for the minimum, a maxImageCount of 0 means there is no limit */
+	uint32_t min_image_count = swapchain->requested_nimages;
+	if (min_image_count < surface_caps.minImageCount) {
+		min_image_count = surface_caps.minImageCount;
+	}
+	if (surface_caps.maxImageCount > 0 && min_image_count > surface_caps.maxImageCount) {
+		min_image_count = surface_caps.maxImageCount;
+	}
 
 	VkSwapchainCreateInfoKHR create_info = {
 		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
 		.surface = surface,
-		.minImageCount = surface_caps.minImageCount,
+		.minImageCount = min_image_count,
 		.imageFormat = RENDER_FORMAT,
 		.imageExtent = surface_caps.currentExtent,
 		.imageArrayLayers = 1,
@@ -290,7 +451,7 @@ create_swapchain(struct vulkan_ctx *vk, VkSurfaceKHR surface,
 		.pQueueFamilyIndices = &vk->queue_family_index,
 		.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
 		.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-		.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR,
+		.presentMode = present_mode,
 		.clipped = false,
 		.oldSwapchain = swapchain->vk_swapchain,
 	};
@@ -299,11 +460,7 @@ create_swapchain(struct vulkan_ctx *vk, VkSurfaceKHR surface,
 		return res;
 	}
 	swapchain->extent = create_info.imageExtent;
-
-	/* need to destroy old swapchain if we are recreating */
-	if (create_info.oldSwapchain != VK_NULL_HANDLE) {
-		vkDestroySwapchainKHR(vk->device, create_info.oldSwapchain, NULL);
-	}
+	swapchain->present_mode = present_mode;
 
 	uint32_t nimages = 0;
 	res = vkGetSwapchainImagesKHR(vk->device, swapchain->vk_swapchain, &nimages, NULL);
@@ -324,75 +481,203 @@ create_swapchain(struct vulkan_ctx *vk, VkSurfaceKHR surface,
 	swapchain->images = images;
 
 	for (uint32_t i = 0; i < nimages; i++) {
-		VkImageViewCreateInfo image_view_create = {
-			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-			.flags = 0,
-			.image = vk_images[i],
-			.viewType = VK_IMAGE_VIEW_TYPE_2D,
-			.format = RENDER_FORMAT,
-			.components = {
-				.r = VK_COMPONENT_SWIZZLE_R,
-				.g = VK_COMPONENT_SWIZZLE_G,
-				.b = VK_COMPONENT_SWIZZLE_B,
-				.a = VK_COMPONENT_SWIZZLE_A,
-			},
-			.subresourceRange = {
-				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-				.baseMipLevel = 0,
-				.levelCount = 1,
-				.baseArrayLayer = 0,
-				.layerCount = 1,
-			},
-		};
-		VkImageView image_view;
-		res = vkCreateImageView(vk->device, &image_view_create, NULL, &image_view);
+		res = init_swapchain_image(vk, render_pass, create_info.imageExtent,
+				vk_images[i], &swapchain->images[i]);
 		if (res != VK_SUCCESS) {
 			return res;
 		}
 
-		VkFramebufferCreateInfo framebuffer_create = {
-			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-			.renderPass = render_pass,
-			.attachmentCount = 1,
-			.pAttachments = &image_view,
-			.width = create_info.imageExtent.width,
-			.height = create_info.imageExtent.height,
-			.layers = 1,
-		};
-		VkFramebuffer framebuffer;
-		vkCreateFramebuffer(vk->device, &framebuffer_create, NULL, &framebuffer);
+		VkSemaphore rendering_semaphore;
+		res = vulkan_ctx_create_semaphore(vk, &rendering_semaphore);
 		if (res != VK_SUCCESS) {
 			return res;
 		}
 
-		swapchain->images[i].image = vk_images[i];
-		swapchain->images[i].image_view = image_view;
-		swapchain->images[i].framebuffer = framebuffer;
+		swapchain->images[i].rendering_semaphore = rendering_semaphore;
 	}
 
 	free(vk_images);
 	return res;
 }
 
+/*
+ * color targets owned by the app, rendered to in turn instead of presented.
+ * usage is what they are used for besides rendering.
+ */
+static VkResult
+create_offscreen_targets(struct vulkan_ctx *vk, VkRenderPass render_pass,
+		VkExtent2D extent, uint32_t nimages, VkImageUsageFlags usage,
+		struct swapchain *swapchain) {
+	VkResult res;
+
+	swapchain->offscreen = true;
+	swapchain->extent = extent;
+	swapchain->images = calloc(nimages, sizeof(struct swapchain_image));
+	if (swapchain->images == NULL) {
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+
+	for (uint32_t i = 0; i < nimages; i++) {
+		struct swapchain_image *target = &swapchain->images[i];
+		VkImageCreateInfo create_info = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = RENDER_FORMAT,
+			.extent = {
+				.width = extent.width,
+				.height = extent.height,
+				.depth = 1,
+			},
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | usage,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			.queueFamilyIndexCount = 1,
+			.pQueueFamilyIndices = &vk->queue_family_index,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+		VkImage vk_image;
+		res = vkCreateImage(vk->device, &create_info, NULL, &vk_image);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(vk->device, vk_image, &requirements);
+		res = memory_allocator_alloc(&vk->allocator, &requirements,
+				vk->device_local_memory_index, false, &target->allocation);
+		if (res != VK_SUCCESS) {
+			vkDestroyImage(vk->device, vk_image, NULL);
+			return res;
+		}
+
+		res = vkBindImageMemory(vk->device, vk_image, target->allocation.memory,
+				target->allocation.offset);
+		if (res == VK_SUCCESS) {
+			res = init_swapchain_image(vk, render_pass, extent, vk_image, target);
+		}
+		if (res != VK_SUCCESS) {
+			vkDestroyImage(vk->device, vk_image, NULL);
+			memory_allocator_free(&vk->allocator, &target->allocation);
+			return res;
+		}
+		/* only count complete targets, destroy_swapchain_related_resources frees them */
+		swapchain->nimages++;
+	}
+	return VK_SUCCESS;
+}
+
 struct app_params {
 	uint32_t width;
 	uint32_t height;
 	bool disjoint;
 	enum image_format format;
+	enum image_upload_mode upload_mode;
+	enum image_conversion conversion;
+	enum image_color_model color_model;
+	enum image_color_range color_range;
+	enum scale_filter filter;
+	/* what the frames are sampled with, nearest if linear isn't supported */
+	VkFilter sampler_filter;
+	double fps;
+	uint32_t nslots;
+	/* streams shown as a wall, 1 shows the sequence on its own */
+	uint32_t ntiles;
+	uint32_t nworkers;
+	uint32_t readahead_depth;
+	uint32_t nframes;
+	VkPresentModeKHR present_mode;
+	uint32_t nimages;
+	enum pacer_mode pacing;
+	uint32_t timing_interval;
+	bool headless;
+	/* frames rendered headless, 0 renders until interrupted */
+	uint64_t headless_frames;
+	/* size of the headless targets, 0 makes them the size of the frames */
+	uint32_t output_width;
+	uint32_t output_height;
+	/* chrome trace json is written here, NULL disables tracing */
+	char *trace_path;
+	/* a json line with the results is appended here, NULL writes none */
+	char *report_path;
+	/* pipelines are compiled as if the cache on disk was empty */
+	bool cold_cache;
+	/* runs the startup tasks one after the other, to compare */
+	bool serial_startup;
+	/* staging uploads may copy straight from the imported file mapping */
+	bool host_import;
+	/* frames are generated in memory instead of read from image_path */
+	bool synthetic;
 	char *image_path;
 };
 
 static void
 validate_args(struct app_params *params, struct vulkan_ctx *vk) {
+	/* the staging ring is recycled by waiting on its timeline */
+	if (params->upload_mode == IMAGE_UPLOAD_MODE_STAGING && !vk->timeline_semaphore) {
+		fprintf(stderr, "validate_args - timelineSemaphore not supported... "
+				"falling back to linear upload\n");
+		params->upload_mode = IMAGE_UPLOAD_MODE_LINEAR;
+	}
+
 	VkFormatProperties format_properties;
 	vkGetPhysicalDeviceFormatProperties(vk->physical_device,
 			image_format_to_vk_format(params->format), &format_properties);
-	if (params->disjoint && !(format_properties.linearTilingFeatures
-				& VK_FORMAT_FEATURE_DISJOINT_BIT)) {
+	VkFormatFeatureFlags tiling_features =
+		params->upload_mode == IMAGE_UPLOAD_MODE_STAGING
+		? format_properties.optimalTilingFeatures
+		: format_properties.linearTilingFeatures;
+	if (params->upload_mode == IMAGE_UPLOAD_MODE_STAGING
+			&& !(tiling_features & VK_FORMAT_FEATURE_TRANSFER_DST_BIT)) {
+		fprintf(stderr, "validate_args - optimal tiling does not support "
+				"VK_FORMAT_FEATURE_TRANSFER_DST_BIT... "
+				"falling back to linear upload\n");
+		params->upload_mode = IMAGE_UPLOAD_MODE_LINEAR;
+		tiling_features = format_properties.linearTilingFeatures;
+	}
+	if (params->disjoint && !(tiling_features & VK_FORMAT_FEATURE_DISJOINT_BIT)) {
 		fprintf(stderr, "validate_args - VK_FORMAT_FEATURE_DISJOINT_BIT "
 				"not supported... disabling disjoint feature\n");
 		params->disjoint = false;
 	}
+
+	/*
+	 * ycbcr samplers can't be indexed dynamically, so walls sample rgba
+	 * images converted in compute, and draw them at the size of a tile.
+	 */
+	if (params->ntiles > 1 && !vk->descriptor_indexing) {
+		fprintf(stderr, "validate_args - shaderSampledImageArrayNonUniformIndexing "
+				"not supported... showing a single stream\n");
+		params->ntiles = 1;
+	}
+	if (params->ntiles > 1 && params->conversion != IMAGE_CONVERSION_COMPUTE) {
+		fprintf(stderr, "validate_args - walls need compute conversion... "
+				"converting in compute\n");
+		params->conversion = IMAGE_CONVERSION_COMPUTE;
+	}
+	if (params->ntiles > 1 && scale_filter_separable(params->filter)) {
+		fprintf(stderr, "validate_args - walls can't use separable filters... "
+				"scaling with bilinear\n");
+		params->filter = SCALE_FILTER_BILINEAR;
+	}
+
+	/* the compute conversion filters its rgba8 image, which always supports it */
+	VkFormatFeatureFlags linear_features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+		| VK_FORMAT_FEATURE_SAMPLED_IMAGE_YCBCR_CONVERSION_LINEAR_FILTER_BIT;
+	params->sampler_filter = params->filter == SCALE_FILTER_NEAREST
+		? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
+	if (params->sampler_filter == VK_FILTER_LINEAR
+			&& params->conversion == IMAGE_CONVERSION_SAMPLER
+			&& (tiling_features & linear_features) != linear_features) {
+		fprintf(stderr, "validate_args - linear ycbcr filtering not supported... "
+				"sampling frames with nearest filtering\n");
+		params->sampler_filter = VK_FILTER_NEAREST;
+		if (params->filter == SCALE_FILTER_BILINEAR) {
+			params->filter = SCALE_FILTER_NEAREST;
+		}
+	}
 }
 
 static void
@@ -401,9 +686,55 @@ parse_args(struct app_params *params, int argc, char *argv[]) {
 	params->height = -1;
 	params->format = -1;
 	params->disjoint = false;
+	params->upload_mode = IMAGE_UPLOAD_MODE_LINEAR;
+	params->conversion = IMAGE_CONVERSION_SAMPLER;
+	params->color_model = IMAGE_COLOR_MODEL_BT709;
+	params->color_range = IMAGE_COLOR_RANGE_FULL;
+	params->filter = SCALE_FILTER_BILINEAR;
+	params->sampler_filter = VK_FILTER_LINEAR;
+	params->fps = 0.0;
+	params->nslots = 3;
+	params->ntiles = 1;
+	params->nworkers = 1;
+	params->readahead_depth = 8;
+	params->nframes = 2;
+	params->present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+	params->nimages = 0;
+	params->pacing = PACER_MODE_CONTENT;
+	params->timing_interval = 0;
+	params->headless = false;
+	params->headless_frames = 0;
+	params->output_width = 0;
+	params->output_height = 0;
+	params->trace_path = NULL;
+	params->report_path = NULL;
+	params->cold_cache = false;
+	params->serial_startup = false;
+	params->host_import = true;
+	params->synthetic = false;
+	params->image_path = NULL;
+
+	static const struct option long_options[] = {
+		{ "headless", no_argument, NULL, 'H' },
+		{ "frames", required_argument, NULL, 'N' },
+		{ "trace", required_argument, NULL, 'T' },
+		{ "report", required_argument, NULL, 'R' },
+		{ "synthetic", no_argument, NULL, 'Y' },
+		{ "convert", required_argument, NULL, 'C' },
+		{ "matrix", required_argument, NULL, 'M' },
+		{ "range", required_argument, NULL, 'L' },
+		{ "filter", required_argument, NULL, 'F' },
+		{ "output", required_argument, NULL, 'O' },
+		{ "tiles", required_argument, NULL, 'W' },
+		{ "cold-cache", no_argument, NULL, 'K' },
+		{ "serial-startup", no_argument, NULL, 'S' },
+		{ "no-host-import", no_argument, NULL, 'X' },
+		{ 0 },
+	};
 
 	int opt;
-	while ((opt = getopt(argc, argv, "w:h:f:d")) != -1) {
+	while ((opt = getopt_long(argc, argv, "w:h:f:du:r:n:j:k:i:p:c:s:t:",
+					long_options, NULL)) != -1) {
 		switch (opt) {
 			case 'w':
 				params->width = atoi(optarg);
@@ -430,11 +761,228 @@ parse_args(struct app_params *params, int argc, char *argv[]) {
 			case 'd':
 				params->disjoint = true;
 				break;
+			case 'u':
+				if (strcmp(optarg, "linear") == 0) {
+					params->upload_mode = IMAGE_UPLOAD_MODE_LINEAR;
+				} else if (strcmp(optarg, "staging") == 0) {
+					params->upload_mode = IMAGE_UPLOAD_MODE_STAGING;
+				} else {
+					fprintf(stderr, "%s is not a supported upload mode.\n"
+							"supported upload modes are:\n"
+							" - linear\n"
+							" - staging\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'r':
+				params->fps = atof(optarg);
+				if (params->fps <= 0) {
+					goto fail;
+				}
+				break;
+			case 'n':
+				params->nslots = atoi(optarg);
+				if (params->nslots < 1 || params->nslots > MAX_FRAME_SLOTS) {
+					fprintf(stderr, "number of frame slots must be "
+							"between 1 and %d\n", MAX_FRAME_SLOTS);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'j':
+				params->nworkers = atoi(optarg);
+				if (params->nworkers < 1
+						|| params->nworkers > WORKER_POOL_MAX_THREADS) {
+					fprintf(stderr, "number of copy workers must be "
+							"between 1 and %d\n", WORKER_POOL_MAX_THREADS);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'k': {
+				int depth = atoi(optarg);
+				if (depth < 1) {
+					fprintf(stderr, "read-ahead depth must be at least 1\n");
+					exit(EXIT_FAILURE);
+				}
+				params->readahead_depth = depth;
+				break;
+			}
+			case 'i':
+				params->nframes = atoi(optarg);
+				if (params->nframes < 1 || params->nframes > MAX_FRAMES_IN_FLIGHT) {
+					fprintf(stderr, "number of frames in flight must be "
+							"between 1 and %d\n", MAX_FRAMES_IN_FLIGHT);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'p':
+				if (strcmp(optarg, "immediate") == 0) {
+					params->present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+				} else if (strcmp(optarg, "mailbox") == 0) {
+					params->present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+				} else if (strcmp(optarg, "fifo") == 0) {
+					params->present_mode = VK_PRESENT_MODE_FIFO_KHR;
+				} else {
+					fprintf(stderr, "%s is not a supported present mode.\n"
+							"supported present modes are:\n"
+							" - immediate\n"
+							" - mailbox\n"
+							" - fifo\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'c': {
+				/* 0 is allowed and asks for the surface's minimum */
+				int nimages = atoi(optarg);
+				if (nimages < 0 || nimages > MAX_SWAPCHAIN_IMAGES) {
+					fprintf(stderr, "number of swapchain images must be "
+							"between 0 and %d\n", MAX_SWAPCHAIN_IMAGES);
+					exit(EXIT_FAILURE);
+				}
+				params->nimages = nimages;
+				break;
+			}
+			case 's':
+				if (strcmp(optarg, "content") == 0) {
+					params->pacing = PACER_MODE_CONTENT;
+				} else if (strcmp(optarg, "display") == 0) {
+					params->pacing = PACER_MODE_DISPLAY;
+				} else {
+					fprintf(stderr, "%s is not a supported pacing.\n"
+							"supported pacings are:\n"
+							" - content\n"
+							" - display\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 't': {
+				int interval = atoi(optarg);
+				if (interval < 0) {
+					fprintf(stderr, "gpu timing interval must be at least 0\n");
+					exit(EXIT_FAILURE);
+				}
+				params->timing_interval = interval;
+				break;
+			}
+			case 'H':
+				params->headless = true;
+				break;
+			case 'N': {
+				/* strtoull would take signs and spaces, and "" as 0 */
+				char *end;
+				errno = 0;
+				params->headless_frames = strtoull(optarg, &end, 10);
+				if (!isdigit((unsigned char) optarg[0]) || *end != '\0'
+						|| errno != 0) {
+					fprintf(stderr, "number of headless frames must be "
+							"a whole number, 0 renders until interrupted\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+			}
+			case 'T':
+				params->trace_path = optarg;
+				break;
+			case 'R':
+				params->report_path = optarg;
+				break;
+			case 'Y':
+				params->synthetic = true;
+				break;
+			case 'C':
+				if (strcmp(optarg, "sampler") == 0) {
+					params->conversion = IMAGE_CONVERSION_SAMPLER;
+				} else if (strcmp(optarg, "compute") == 0) {
+					params->conversion = IMAGE_CONVERSION_COMPUTE;
+				} else {
+					fprintf(stderr, "%s is not a supported conversion.\n"
+							"supported conversions are:\n"
+							" - sampler\n"
+							" - compute\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'M':
+				if (strcmp(optarg, "601") == 0) {
+					params->color_model = IMAGE_COLOR_MODEL_BT601;
+				} else if (strcmp(optarg, "709") == 0) {
+					params->color_model = IMAGE_COLOR_MODEL_BT709;
+				} else if (strcmp(optarg, "2020") == 0) {
+					params->color_model = IMAGE_COLOR_MODEL_BT2020;
+				} else {
+					fprintf(stderr, "%s is not a supported matrix.\n"
+							"supported matrices are:\n"
+							" - 601\n"
+							" - 709\n"
+							" - 2020\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'L':
+				if (strcmp(optarg, "full") == 0) {
+					params->color_range = IMAGE_COLOR_RANGE_FULL;
+				} else if (strcmp(optarg, "limited") == 0) {
+					params->color_range = IMAGE_COLOR_RANGE_LIMITED;
+				} else {
+					fprintf(stderr, "%s is not a supported range.\n"
+							"supported ranges are:\n"
+							" - full\n"
+							" - limited\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'F':
+				if (strcmp(optarg, "nearest") == 0) {
+					params->filter = SCALE_FILTER_NEAREST;
+				} else if (strcmp(optarg, "bilinear") == 0) {
+					params->filter = SCALE_FILTER_BILINEAR;
+				} else if (strcmp(optarg, "bicubic") == 0) {
+					params->filter = SCALE_FILTER_BICUBIC;
+				} else if (strcmp(optarg, "lanczos") == 0) {
+					params->filter = SCALE_FILTER_LANCZOS;
+				} else {
+					fprintf(stderr, "%s is not a supported filter.\n"
+							"supported filters are:\n"
+							" - nearest\n"
+							" - bilinear\n"
+							" - bicubic\n"
+							" - lanczos\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'O':
+				if (sscanf(optarg, "%ux%u", &params->output_width,
+							&params->output_height) != 2
+						|| params->output_width == 0 || params->output_height == 0) {
+					fprintf(stderr, "%s is not an output size, "
+							"expected WIDTHxHEIGHT\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'W':
+				params->ntiles = atoi(optarg);
+				if (params->ntiles < 1 || params->ntiles > WALL_MAX_TILES) {
+					fprintf(stderr, "number of tiles must be "
+							"between 1 and %d\n", WALL_MAX_TILES);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'K':
+				params->cold_cache = true;
+				break;
+			case 'S':
+				params->serial_startup = true;
+				break;
+			case 'X':
+				params->host_import = false;
+				break;
 			default:
 				goto fail;
 		}
 	}
 
+	if (params->synthetic) {
+		return;
+	}
 	if (optind >= argc) {
 		goto fail;
 	}
@@ -443,102 +991,779 @@ parse_args(struct app_params *params, int argc, char *argv[]) {
 	return;
 
 fail:
-	fprintf(stderr, "usage: %s [-w width] [-h height] [-f format] [-d] file\n"
-			"  -d\tenable disjoint planes\n",
+	fprintf(stderr, "usage: %s [-w width] [-h height] [-f format] [-d] "
+			"[-u upload] [-r fps] [-n slots] [-j workers] [-k frames] [-i frames] "
+			"[-p present] [-c images] [-s pacing] [-t frames] "
+			"[--headless [--frames n] [--output WxH]] [--trace file] "
+			"[--report file] [--convert conversion] [--matrix matrix] "
+			"[--range range] [--filter filter] [--tiles n] [--cold-cache] "
+			"[--serial-startup] [--no-host-import] {--synthetic | file}\n"
+			"  -w, -h, -f\tgeometry of raw files, y4m files carry their own\n"
+			"  -d\tenable disjoint planes\n"
+			"  -u\tupload mode, linear (default) or staging\n"
+			"  -r\tplayback frame rate (default from the file, or 30)\n"
+			"  -n\tnumber of preallocated frame slots (default 3)\n"
+			"  -j\tnumber of threads copying frames (default 1)\n"
+			"  -k\tframes faulted in ahead of playback, at least 1 (default 8)\n"
+			"  -i\tframes rendered in flight (default 2)\n"
+			"  -p\tpresent mode, immediate (default), mailbox or fifo\n"
+			"  -c\tswapchain images, clamped to the surface limits (default minimum)\n"
+			"  -s\tstart frames to meet the content frame time (content, default)\n"
+			"    \tor the first display refresh after it (display)\n"
+			"  -t\tprint gpu timings every this many frames, 0 only on exit (default 0)\n"
+			"  --headless\trender offscreen as fast as possible, without X\n"
+			"  --frames\tframes to render headless, 0 until interrupted (default 0)\n"
+			"  --output\tsize rendered to headless (default the size of the frames)\n"
+			"  --trace\twrite cpu and gpu timelines as chrome trace json\n"
+			"  --report\tappend the results as a line of json\n"
+			"  --synthetic\tgenerate frames of the given geometry in memory\n"
+			"  --convert\tto rgb through the sampler (default) or a compute shader\n"
+			"  --matrix\tycbcr matrix, 601, 709 (default) or 2020\n"
+			"  --range\tycbcr range, full (default) or limited\n"
+			"  --filter\tscaling to the window, nearest, bilinear (default),\n"
+			"    \tbicubic or lanczos\n"
+			"  --tiles\tshow the sequence as a wall of this many streams, each\n"
+			"    \tstarted at a different frame (default 1)\n"
+			"  --cold-cache\tcompile pipelines without the cache in $XDG_CACHE_HOME\n"
+			"  --serial-startup\tcreate the window, pipelines and first uploads\n"
+			"    \tone after the other instead of concurrently\n"
+			"  --no-host-import\tcopy staging uploads through the staging ring,\n"
+			"    \tnever straight from the imported file mapping\n",
 			argv[0]);
 	exit(EXIT_FAILURE);
 }
 
-struct app {
-	struct window *window;
-	struct vulkan_ctx *vk;
-
-	VkSurfaceKHR surface;
-	VkRenderPass render_pass;
-	struct swapchain swapchain;
-
-	VkCommandPool cmd_pool;
-	VkCommandBuffer cmd;
-
-	VkSemaphore image_acquisition_semaphore;
-	VkSemaphore rendering_semaphore;
-	VkFence inflight_fence;
-
-	struct image_sampler sampler;
-	struct image image;
-	VkImageView image_view;
+/*
+ * frames of the sequence are uploaded into a ring of preallocated images.
+ * absolute frame n always lives in slot n % nslots, so while one slot is
+ * being sampled the following ones can be refilled from the mapping.
+ */
+struct slot_tile {
+	struct pooled_image *image;
+
+	/*
+	 * only with compute conversion: the rgba image drawn instead of image,
+	 * written from it at the start of every frame showing the slot
+	 */
+	VkImage rgb_image;
+	struct memory_allocation rgb_allocation;
+	VkImageView rgb_view;
+	VkDescriptorSet convert_descriptor_set;
+};
 
-	VkDescriptorPool descriptor_pool;
-	VkDescriptorSetLayout descriptor_set_layout;
+/*
+ * a video wall plays a stream per tile, each uploaded into an image of its
+ * own. the streams are the sequence, started at evenly spaced frames.
+ */
+struct frame_slot {
+	struct slot_tile tiles[WALL_MAX_TILES];
 	VkDescriptorSet descriptor_set;
 
-	struct graphics_pipeline pipeline;
+	/* index into the sequence of the frame tile 0 currently holds */
+	uint32_t frame;
+	/* render timeline value of the last frame sampling the slot */
+	uint64_t last_use;
 };
 
+/* the rgba image a tile is converted into, sampled by the render pass */
 static VkResult
-acquire_next_image(struct app *app, uint32_t *image_ind) {
-	VkResult res = VK_TIMEOUT;
-	while (res == VK_NOT_READY || res == VK_TIMEOUT) {
-		res = vkAcquireNextImageKHR(app->vk->device, app->swapchain.vk_swapchain,
-			30, app->image_acquisition_semaphore, NULL, image_ind);
-	}
-	return res;
-}
+create_convert_target(struct vulkan_ctx *vk, uint32_t width, uint32_t height,
+		struct slot_tile *tile) {
+	VkResult res;
 
-static VkResult
-build_cmd_buffer_for_fb(struct app *app, VkCommandBuffer cmd, VkFramebuffer fb) {
-	VkResult res = VK_SUCCESS;
+	VkImageCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = VK_FORMAT_R8G8B8A8_UNORM,
+		.extent = {
+			.width = width,
+			.height = height,
+			.depth = 1,
+		},
+		.mipLevels = 1,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 1,
+		.pQueueFamilyIndices = &vk->queue_family_index,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+	};
+	res = vkCreateImage(vk->device, &create_info, NULL, &tile->rgb_image);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
 
-	res = vkResetCommandBuffer(cmd, 0);
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(vk->device, tile->rgb_image, &requirements);
+	res = memory_allocator_alloc(&vk->allocator, &requirements,
+			vk->device_local_memory_index, false, &tile->rgb_allocation);
 	if (res != VK_SUCCESS) {
+		vkDestroyImage(vk->device, tile->rgb_image, NULL);
 		return res;
 	}
 
-	VkCommandBufferBeginInfo cmd_begin_info = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-	};
-	res = vkBeginCommandBuffer(cmd, &cmd_begin_info);
+	res = vkBindImageMemory(vk->device, tile->rgb_image,
+			tile->rgb_allocation.memory, tile->rgb_allocation.offset);
 	if (res != VK_SUCCESS) {
+		memory_allocator_free(&vk->allocator, &tile->rgb_allocation);
+		vkDestroyImage(vk->device, tile->rgb_image, NULL);
 		return res;
 	}
 
-	VkClearValue clear_value = {
-		.color = {
-			.float32 = { 1.0f, 0, 1.0f, 1.0f },
-		}
+	VkImageViewCreateInfo image_view_create = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image = tile->rgb_image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = VK_FORMAT_R8G8B8A8_UNORM,
+		.components = {
+			.r = VK_COMPONENT_SWIZZLE_R,
+			.g = VK_COMPONENT_SWIZZLE_G,
+			.b = VK_COMPONENT_SWIZZLE_B,
+			.a = VK_COMPONENT_SWIZZLE_A,
+		},
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+	res = vkCreateImageView(vk->device, &image_view_create, NULL, &tile->rgb_view);
+	if (res != VK_SUCCESS) {
+		memory_allocator_free(&vk->allocator, &tile->rgb_allocation);
+		vkDestroyImage(vk->device, tile->rgb_image, NULL);
+		return res;
+	}
+	return VK_SUCCESS;
+}
+
+static void
+destroy_convert_target(struct vulkan_ctx *vk, struct slot_tile *tile) {
+	vkDestroyImageView(vk->device, tile->rgb_view, NULL);
+	vkDestroyImage(vk->device, tile->rgb_image, NULL);
+	memory_allocator_free(&vk->allocator, &tile->rgb_allocation);
+	tile->rgb_view = VK_NULL_HANDLE;
+	tile->rgb_image = VK_NULL_HANDLE;
+}
+
+struct playback {
+	struct sequence sequence;
+	struct readahead readahead;
+	double fps;
+	uint64_t start_ns;
+	/* frames are picked as of this far ahead of now, set by the pacer */
+	uint64_t lead_ns;
+	/* every rendered frame shows the next one, regardless of the clock */
+	bool unpaced;
+
+	uint32_t nslots;
+	struct frame_slot slots[MAX_FRAME_SLOTS];
+	uint64_t current;
+	/* streams played side by side, 1 unless showing a wall */
+	uint32_t ntiles;
+
+	uint64_t frames_shown;
+	uint64_t uploads;
+	uint64_t late_uploads;
+};
+
+/* the frame of the sequence a tile holds while tile 0 holds frame */
+static uint32_t
+playback_tile_frame(struct playback *playback, uint32_t frame, uint32_t tile) {
+	uint32_t frame_count = playback->sequence.frame_count;
+	return (frame + (uint64_t) tile * frame_count / playback->ntiles) % frame_count;
+}
+
+/* resources of a frame recorded while earlier frames are still rendering */
+struct frame_context {
+	VkSemaphore image_acquisition_semaphore;
+	VkFence inflight_fence;
+	/* write the timestamps of the frame before and after its recorded draw */
+	VkCommandBuffer timing_cmds[2];
+};
+
+/*
+ * the draw of a frame slot into a swapchain image never changes, so it is
+ * recorded once and submitted again until its generation goes stale.
+ */
+struct recorded_cmd {
+	VkCommandBuffer cmd;
+	uint64_t generation;
+};
+
+/* the parts of app_init that only depend on the device, run concurrently */
+enum startup_task {
+	STARTUP_TASK_RENDER_TARGETS,
+	STARTUP_TASK_PIPELINES,
+	STARTUP_TASK_UPLOADS,
+	STARTUP_TASK_COUNT,
+};
+
+/*
+ * what a swapchain recreation replaced. frames submitted before it may still
+ * render into the old images or present them, so it is destroyed once the
+ * render timeline is past them instead of waiting for the device to idle.
+ */
+struct retired_swapchain {
+	uint64_t release_value;
+
+	struct swapchain swapchain;
+	struct swapchain scale_targets;
+	VkDescriptorPool scale_descriptor_pool;
+	VkDescriptorSet *scale_descriptor_sets;
+	uint32_t nrecorded_cmds;
+	struct recorded_cmd *recorded_cmds;
+
+	struct retired_swapchain *next;
+};
+
+struct frame_stats {
+	uint64_t frames;
+	uint64_t cmd_records;
+	uint64_t swapchain_recreations;
+	/* cpu time of app_render, including the waits below */
+	uint64_t frame_ns;
+	uint64_t max_frame_ns;
+	/* time blocked on fences of earlier frames */
+	uint64_t wait_ns;
+};
+
+struct app {
+	struct window *window;
+	struct vulkan_ctx *vk;
+
+	VkSurfaceKHR surface;
+	VkRenderPass render_pass;
+	struct swapchain swapchain;
+	/* acquire or present returned VK_ERROR_OUT_OF_DATE_KHR, recreate at any size */
+	bool swapchain_out_of_date;
+	/* newest first, released in app_render as their frames finish */
+	struct retired_swapchain *retired_swapchains;
+
+	VkCommandPool cmd_pool;
+
+	/* the cpu prepares frame_index while up to nframes - 1 others render */
+	uint32_t nframes;
+	uint32_t frame_index;
+	struct frame_context frames[MAX_FRAMES_IN_FLIGHT];
+
+	/* signalled with the number of frames submitted so far */
+	VkSemaphore render_timeline;
+	uint64_t frames_submitted;
+
+	/* indexed by swapchain image * nslots + frame slot */
+	uint32_t nrecorded_cmds;
+	struct recorded_cmd *recorded_cmds;
+	/* bumped whenever something the recorded commands use changes */
+	uint64_t cmd_generation;
+	struct frame_stats frame_stats;
+	struct pacer pacer;
+
+	/* when main started, and how long until the first frame was submitted */
+	uint64_t launch_ns;
+	uint64_t first_frame_ns;
+	/* app_init as a whole, and each of the tasks it runs side by side */
+	uint64_t init_ns;
+	uint64_t startup_task_ns[STARTUP_TASK_COUNT];
+	bool serial_startup;
+
+	/* a timestamp set per frame in flight, printed every timing_interval frames */
+	struct gpu_timings gpu_timings;
+	struct gpu_timer gpu_timer;
+	uint32_t timing_interval;
+	const char *report_path;
+
+	struct image_sampler sampler;
+	struct image_uploader uploader;
+	struct image_pool image_pool;
+	struct playback playback;
+
+	VkDescriptorPool descriptor_pool;
+	VkDescriptorSetLayout descriptor_set_layout;
+
+	struct graphics_pipeline pipeline;
+	struct convert_pipeline convert;
+
+	/* separable filters scale into an intermediate per swapchain image first */
+	enum scale_filter filter;
+	VkRenderPass scale_render_pass;
+	struct scale_pipeline scale;
+	struct swapchain scale_targets;
+	VkDescriptorPool scale_descriptor_pool;
+	VkDescriptorSet *scale_descriptor_sets;
+
+	/* only with more than one tile, which replaces pipeline */
+	struct wall wall;
+	struct wall_pipeline wall_pipeline;
+};
+
+/* the largest rectangle of the frames' aspect ratio, centered in extent */
+static VkRect2D
+letterbox_rect(VkExtent2D extent, uint32_t width, uint32_t height) {
+	VkRect2D rect = { .extent = extent };
+	if ((uint64_t) extent.width * height > (uint64_t) extent.height * width) {
+		rect.extent.width = ((uint64_t) extent.height * width + height / 2) / height;
+	} else {
+		rect.extent.height = ((uint64_t) extent.width * height + width / 2) / width;
+	}
+	if (rect.extent.width == 0) {
+		rect.extent.width = 1;
+	}
+	if (rect.extent.height == 0) {
+		rect.extent.height = 1;
+	}
+	rect.offset.x = (extent.width - rect.extent.width) / 2;
+	rect.offset.y = (extent.height - rect.extent.height) / 2;
+	return rect;
+}
+
+static VkRect2D
+app_letterbox_rect(struct app *app) {
+	uint32_t width = app->playback.sequence.width;
+	uint32_t height = app->playback.sequence.height;
+	if (app->playback.ntiles > 1) {
+		wall_size(&app->wall, width, height, &width, &height);
+	}
+	return letterbox_rect(app->swapchain.extent, width, height);
+}
+
+static void
+destroy_scale_targets(struct app *app) {
+	destroy_swapchain_related_resources(app->vk, &app->scale_targets);
+	vkDestroyDescriptorPool(app->vk->device, app->scale_descriptor_pool, NULL);
+	app->scale_descriptor_pool = VK_NULL_HANDLE;
+	free(app->scale_descriptor_sets);
+	app->scale_descriptor_sets = NULL;
+}
+
+/*
+ * an intermediate per swapchain image, as wide as the letterbox and as tall
+ * as the frames. none of the previous ones may be in use anymore.
+ */
+static VkResult
+create_scale_targets(struct app *app) {
+	struct vulkan_ctx *vk = app->vk;
+	VkResult res;
+
+	destroy_scale_targets(app);
+
+	uint32_t nimages = app->swapchain.nimages;
+	VkExtent2D extent = {
+		.width = app_letterbox_rect(app).extent.width,
+		.height = app->playback.sequence.height,
 	};
+	res = create_offscreen_targets(vk, app->scale_render_pass, extent, nimages,
+			VK_IMAGE_USAGE_SAMPLED_BIT, &app->scale_targets);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	VkDescriptorPoolCreateInfo pool_create = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.poolSizeCount = 1,
+		.pPoolSizes = &(VkDescriptorPoolSize) {
+			.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = nimages,
+		},
+		.maxSets = nimages,
+	};
+	res = vkCreateDescriptorPool(vk->device, &pool_create, NULL,
+			&app->scale_descriptor_pool);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	app->scale_descriptor_sets = calloc(nimages, sizeof(VkDescriptorSet));
+	if (app->scale_descriptor_sets == NULL) {
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+	for (uint32_t i = 0; i < nimages; i++) {
+		res = allocate_descriptor_set(vk, &app->scale_descriptor_sets[i],
+				app->scale_descriptor_pool, app->scale.descriptor_set_layout);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+		update_descriptor_with_image(vk, app->scale_descriptor_sets[i], 0,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, app->scale.sampler,
+				app->scale_targets.images[i].image_view,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+	return VK_SUCCESS;
+}
+
+static VkResult
+acquire_next_image(struct app *app, VkSemaphore semaphore, uint32_t *image_ind) {
+	TRACE_SCOPE("acquire_next_image");
+	VkResult res = VK_TIMEOUT;
+	while (res == VK_NOT_READY || res == VK_TIMEOUT) {
+		res = vkAcquireNextImageKHR(app->vk->device, app->swapchain.vk_swapchain,
+			UINT64_MAX, semaphore, NULL, image_ind);
+	}
+	return res;
+}
+
+static uint64_t
+now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+static uint64_t
+playback_target_frame(struct playback *playback) {
+	if (playback->unpaced) {
+		/* current starts out as UINT64_MAX, so this begins at frame 0 */
+		return playback->current + 1;
+	}
+	double elapsed = (now_ns() + playback->lead_ns - playback->start_ns) / 1e9;
+	return (uint64_t) (elapsed * playback->fps);
+}
+
+static uint64_t
+playback_due_ns(struct playback *playback, uint64_t frame) {
+	return playback->start_ns + (uint64_t) (frame * 1e9 / playback->fps);
+}
+
+/* whether the frame due now differs from the one on screen */
+static bool
+playback_frame_changed(struct playback *playback) {
+	if (playback->current == UINT64_MAX) {
+		return true;
+	}
+	uint32_t frame_count = playback->sequence.frame_count;
+	return playback_target_frame(playback) % frame_count
+		!= playback->current % frame_count;
+}
+
+/*
+ * milliseconds until the pacer wants the next frame started, -1 if the
+ * picture never changes
+ */
+static int
+playback_timeout_ms(struct playback *playback, struct pacer *pacer) {
+	if (playback->sequence.frame_count <= 1 && playback->current != UINT64_MAX) {
+		return -1;
+	}
+
+	uint64_t wake = pacer_wake_time(pacer,
+			playback_due_ns(playback, playback->current + 1));
+	playback->lead_ns = pacer->lead_ns;
+	uint64_t now = now_ns();
+	if (wake <= now) {
+		return 0;
+	}
+	/* rounded up, waking early would only spin until the frame is due */
+	return (wake - now) / 1000000 + 1;
+}
+
+static VkResult
+playback_fill_slot(struct app *app, uint64_t frame) {
+	struct playback *playback = &app->playback;
+	struct frame_slot *slot = &playback->slots[frame % playback->nslots];
+	uint32_t sequence_frame_index = frame % playback->sequence.frame_count;
+	if (slot->frame == sequence_frame_index) {
+		return VK_SUCCESS;
+	}
+
+	/*
+	 * linear images are written by the cpu, so frames still sampling the slot
+	 * have to finish first. staging copies are ordered on the gpu instead.
+	 */
+	VkResult res;
+	if (slot->tiles[0].image->image.tiling == VK_IMAGE_TILING_LINEAR
+			&& slot->last_use > 0) {
+		VkSemaphoreWaitInfo wait_info = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+			.semaphoreCount = 1,
+			.pSemaphores = &app->render_timeline,
+			.pValues = &slot->last_use,
+		};
+		res = vkWaitSemaphores(app->vk->device, &wait_info, UINT64_MAX);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+	}
+
+	/* the other streams are further along, uploading them faults them in */
+	readahead_wait(&playback->readahead, frame);
+	for (uint32_t tile = 0; tile < playback->ntiles; tile++) {
+		uint32_t tile_frame = playback_tile_frame(playback, sequence_frame_index, tile);
+		res = image_upload(&slot->tiles[tile].image->image, app->vk, &app->uploader,
+				sequence_frame(&playback->sequence, tile_frame));
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+	}
+
+	slot->frame = sequence_frame_index;
+	playback->uploads += playback->ntiles;
+	return VK_SUCCESS;
+}
+
+/* only call while no submission references the slot of the current frame */
+static struct frame_slot *
+playback_advance(struct app *app) {
+	struct playback *playback = &app->playback;
+	uint64_t target = playback_target_frame(playback);
+	struct frame_slot *slot = &playback->slots[target % playback->nslots];
+
+	if (slot->frame != target % playback->sequence.frame_count) {
+		playback->late_uploads++;
+		VkResult res = playback_fill_slot(app, target);
+		assert(res == VK_SUCCESS);
+	}
+
+	if (target != playback->current) {
+		playback->frames_shown++;
+	}
+	playback->current = target;
+	return slot;
+}
+
+/* refill every slot except the current one, which may be sampled by the gpu */
+static void
+playback_fill_ahead(struct app *app) {
+	struct playback *playback = &app->playback;
+	for (uint32_t i = 1; i < playback->nslots; i++) {
+		VkResult res = playback_fill_slot(app, playback->current + i);
+		assert(res == VK_SUCCESS);
+	}
+}
+
+/*
+ * the rgba images of the slot are fully rewritten, so their old contents are
+ * dropped. earlier frames sampling them are ahead in the queue and waited on.
+ */
+static void
+record_conversion(struct app *app, VkCommandBuffer cmd, struct frame_slot *slot) {
+	uint32_t ntiles = app->playback.ntiles;
+	VkImageMemoryBarrier barriers[WALL_MAX_TILES];
+	for (uint32_t tile = 0; tile < ntiles; tile++) {
+		barriers[tile] = (VkImageMemoryBarrier) {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.newLayout = VK_IMAGE_LAYOUT_GENERAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = slot->tiles[tile].rgb_image,
+			.subresourceRange = (VkImageSubresourceRange) {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		};
+	}
+	vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			0, NULL,
+			0, NULL,
+			ntiles, barriers);
+
+	for (uint32_t tile = 0; tile < ntiles; tile++) {
+		struct image *image = &slot->tiles[tile].image->image;
+		convert_pipeline_dispatch(&app->convert, cmd,
+				slot->tiles[tile].convert_descriptor_set, image->width, image->height);
+
+		barriers[tile].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barriers[tile].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers[tile].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	}
+	vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			0, NULL,
+			0, NULL,
+			ntiles, barriers);
+}
+
+/* runs the horizontal pass of a separable filter into the image's intermediate */
+static void
+record_horizontal_scale(struct app *app, VkCommandBuffer cmd, uint32_t image_ind,
+		struct frame_slot *slot) {
+	struct swapchain_image *target = &app->scale_targets.images[image_ind];
+	VkExtent2D extent = app->scale_targets.extent;
+
 	VkRenderPassBeginInfo begin_info = {
 		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-		.renderPass = app->render_pass,
-		.framebuffer = fb,
+		.renderPass = app->scale_render_pass,
+		.framebuffer = target->framebuffer,
 		.renderArea = {
-			.extent = app->swapchain.extent,
+			.extent = extent,
 			.offset = { 0, 0 },
 		},
-		.clearValueCount = 1,
-		.pClearValues = &clear_value,
 	};
 	vkCmdBeginRenderPass(cmd, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-			app->pipeline.pipeline_layout, 0,
-			1, &app->descriptor_set,
-			0, NULL);
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, app->pipeline.pipeline);
 
 	VkViewport viewport = {
 		.x = 0,
 		.y = 0,
-		.width = app->swapchain.extent.width,
-		.height = app->swapchain.extent.height,
+		.width = extent.width,
+		.height = extent.height,
 	};
 	vkCmdSetViewport(cmd, 0, 1, &viewport);
-	VkRect2D scissor = {
-		.offset = { 0 },
-		.extent = app->swapchain.extent,
+	vkCmdSetScissor(cmd, 0, 1, &begin_info.renderArea);
+
+	scale_pipeline_draw(&app->scale, cmd, SCALE_PASS_HORIZONTAL,
+			slot->descriptor_set, app->playback.sequence.width, extent.width);
+	vkCmdEndRenderPass(cmd);
+
+	VkImageMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = target->image,
+		.subresourceRange = (VkImageSubresourceRange) {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
 	};
-	vkCmdSetScissor(cmd, 0, 1, &scissor);
-	
-	vkCmdDraw(cmd, 6, 1, 0, 0);
+	vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			0, NULL,
+			0, NULL,
+			1, &barrier);
+}
+
+/*
+ * clears the bars around rect to black, a rect filling extent has none. the
+ * cells of a wall without a tile are cleared along with them.
+ */
+static void
+clear_letterbox(struct app *app, VkCommandBuffer cmd, VkRect2D rect) {
+	VkExtent2D extent = app->swapchain.extent;
+	VkClearRect bars[3];
+	uint32_t nbars = 0;
+	if (rect.extent.width < extent.width) {
+		uint32_t right = rect.offset.x + rect.extent.width;
+		bars[nbars++] = (VkClearRect) {
+			.rect = { { 0, 0 }, { rect.offset.x, extent.height } },
+			.layerCount = 1,
+		};
+		bars[nbars++] = (VkClearRect) {
+			.rect = { { right, 0 }, { extent.width - right, extent.height } },
+			.layerCount = 1,
+		};
+	} else if (rect.extent.height < extent.height) {
+		uint32_t bottom = rect.offset.y + rect.extent.height;
+		bars[nbars++] = (VkClearRect) {
+			.rect = { { 0, 0 }, { extent.width, rect.offset.y } },
+			.layerCount = 1,
+		};
+		bars[nbars++] = (VkClearRect) {
+			.rect = { { 0, bottom }, { extent.width, extent.height - bottom } },
+			.layerCount = 1,
+		};
+	}
+	VkRect2D empty;
+	if (app->playback.ntiles > 1 && wall_empty_rect(&app->wall, rect, &empty)) {
+		bars[nbars++] = (VkClearRect) {
+			.rect = empty,
+			.layerCount = 1,
+		};
+	}
+
+	/* a bar can be empty when the letterbox is off by a single pixel */
+	uint32_t nonempty = 0;
+	for (uint32_t i = 0; i < nbars; i++) {
+		if (bars[i].rect.extent.width > 0 && bars[i].rect.extent.height > 0) {
+			bars[nonempty++] = bars[i];
+		}
+	}
+	if (nonempty == 0) {
+		return;
+	}
+
+	VkClearAttachment attachment = {
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.colorAttachment = 0,
+		.clearValue = {
+			.color = {
+				.float32 = { 0.0f, 0.0f, 0.0f, 1.0f },
+			},
+		},
+	};
+	vkCmdClearAttachments(cmd, 1, &attachment, nonempty, bars);
+}
+
+static VkResult
+build_cmd_buffer_for_fb(struct app *app, VkCommandBuffer cmd, uint32_t image_ind,
+		struct frame_slot *slot) {
+	VkResult res = VK_SUCCESS;
+
+	res = vkResetCommandBuffer(cmd, 0);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	VkCommandBufferBeginInfo cmd_begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+	};
+	res = vkBeginCommandBuffer(cmd, &cmd_begin_info);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	if (app->sampler.mode == IMAGE_CONVERSION_COMPUTE) {
+		record_conversion(app, cmd, slot);
+	}
+
+	bool separable = scale_filter_separable(app->filter);
+	if (separable) {
+		record_horizontal_scale(app, cmd, image_ind, slot);
+	}
+
+	VkRenderPassBeginInfo begin_info = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+		.renderPass = app->render_pass,
+		.framebuffer = app->swapchain.images[image_ind].framebuffer,
+		.renderArea = {
+			.extent = app->swapchain.extent,
+			.offset = { 0, 0 },
+		},
+	};
+	vkCmdBeginRenderPass(cmd, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+	VkRect2D rect = app_letterbox_rect(app);
+	clear_letterbox(app, cmd, rect);
+
+	VkViewport viewport = {
+		.x = rect.offset.x,
+		.y = rect.offset.y,
+		.width = rect.extent.width,
+		.height = rect.extent.height,
+	};
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &rect);
+
+	if (app->playback.ntiles > 1) {
+		wall_pipeline_draw(&app->wall_pipeline, cmd, slot->descriptor_set,
+				app->playback.ntiles);
+	} else if (separable) {
+		scale_pipeline_draw(&app->scale, cmd, SCALE_PASS_VERTICAL,
+				app->scale_descriptor_sets[image_ind],
+				app->playback.sequence.height, rect.extent.height);
+	} else {
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+				app->pipeline.pipeline_layout, 0,
+				1, &slot->descriptor_set,
+				0, NULL);
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, app->pipeline.pipeline);
+		vkCmdDraw(cmd, 6, 1, 0, 0);
+	}
 	vkCmdEndRenderPass(cmd);
 
 	res = vkEndCommandBuffer(cmd);
@@ -550,148 +1775,1115 @@ build_cmd_buffer_for_fb(struct app *app, VkCommandBuffer cmd, VkFramebuffer fb)
 }
 
 static void
-app_render(struct app *app) {
+free_recorded_cmds(struct app *app) {
+	for (uint32_t i = 0; i < app->nrecorded_cmds; i++) {
+		vkFreeCommandBuffers(app->vk->device, app->cmd_pool, 1,
+				&app->recorded_cmds[i].cmd);
+	}
+	free(app->recorded_cmds);
+	app->recorded_cmds = NULL;
+	app->nrecorded_cmds = 0;
+}
+
+/* none of the previous command buffers may be pending anymore */
+static VkResult
+allocate_recorded_cmds(struct app *app) {
+	free_recorded_cmds(app);
+
+	uint32_t count = app->swapchain.nimages * app->playback.nslots;
+	app->recorded_cmds = calloc(count, sizeof(struct recorded_cmd));
+	for (uint32_t i = 0; i < count; i++) {
+		VkResult res = create_command_buffer(app->vk, app->cmd_pool,
+				&app->recorded_cmds[i].cmd);
+		if (res != VK_SUCCESS) {
+			app->nrecorded_cmds = i;
+			return res;
+		}
+		app->nrecorded_cmds++;
+	}
+
+	/* generation 0 marks a command buffer that was never recorded */
+	app->cmd_generation++;
+	return VK_SUCCESS;
+}
+
+/*
+ * a stale command buffer can be re-recorded right away: the fence of its
+ * swapchain image was waited on, so it is not pending anymore.
+ */
+static VkCommandBuffer
+get_recorded_cmd(struct app *app, uint32_t image_ind, struct frame_slot *slot) {
+	uint32_t slot_index = slot - app->playback.slots;
+	struct recorded_cmd *recorded =
+		&app->recorded_cmds[image_ind * app->playback.nslots + slot_index];
+
+	if (recorded->generation != app->cmd_generation) {
+		VkResult res = build_cmd_buffer_for_fb(app, recorded->cmd, image_ind, slot);
+		assert(res == VK_SUCCESS);
+		recorded->generation = app->cmd_generation;
+		app->frame_stats.cmd_records++;
+	}
+	return recorded->cmd;
+}
+
+/*
+ * reports presents that reached the display, blocking up to timeout_ns for
+ * the oldest one. a present is only seen as done once this looks at it.
+ */
+static void
+collect_presents(struct app *app, uint64_t timeout_ns) {
+	uint64_t id;
+	while ((id = pacer_oldest_pending(&app->pacer)) != 0) {
+		VkResult res = app->vk->wait_for_present(app->vk->device,
+				app->swapchain.vk_swapchain, id, timeout_ns);
+		if (res == VK_TIMEOUT) {
+			return;
+		} else if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR) {
+			pacer_drop_pending(&app->pacer);
+			return;
+		}
+		pacer_frame_presented(&app->pacer, now_ns());
+		timeout_ns = 0;
+	}
+}
+
+/*
+ * the recorded draws are shared by all frames in flight, so the timestamps
+ * of a frame go into command buffers of its own submitted around the draw.
+ * the draw starts once the swapchain image is acquired and covers conversion,
+ * scaling and the final render pass. the frame starts already when the gpu
+ * picks up the submission.
+ */
+static void
+record_timing_cmds(struct app *app, uint32_t frame_index) {
+	struct frame_context *frame = &app->frames[frame_index];
+	struct gpu_timer *timer = &app->gpu_timer;
+	VkCommandBufferBeginInfo begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	};
+
+	VkCommandBuffer cmd = frame->timing_cmds[0];
+	VkResult res = vkBeginCommandBuffer(cmd, &begin_info);
+	assert(res == VK_SUCCESS);
+	gpu_timer_reset(timer, app->vk, cmd, frame_index);
+	gpu_timer_begin(timer, cmd, frame_index, GPU_STAGE_FRAME,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	gpu_timer_begin(timer, cmd, frame_index, GPU_STAGE_DRAW,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	res = vkEndCommandBuffer(cmd);
+	assert(res == VK_SUCCESS);
+
+	cmd = frame->timing_cmds[1];
+	res = vkBeginCommandBuffer(cmd, &begin_info);
+	assert(res == VK_SUCCESS);
+	gpu_timer_end(timer, cmd, frame_index, GPU_STAGE_DRAW,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	gpu_timer_end(timer, cmd, frame_index, GPU_STAGE_FRAME,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	res = vkEndCommandBuffer(cmd);
+	assert(res == VK_SUCCESS);
+}
+
+static void
+destroy_retired_swapchain(struct app *app, struct retired_swapchain *retired) {
+	struct vulkan_ctx *vk = app->vk;
+	destroy_swapchain_related_resources(vk, &retired->swapchain);
+	vkDestroySwapchainKHR(vk->device, retired->swapchain.vk_swapchain, NULL);
+
+	destroy_swapchain_related_resources(vk, &retired->scale_targets);
+	vkDestroyDescriptorPool(vk->device, retired->scale_descriptor_pool, NULL);
+	free(retired->scale_descriptor_sets);
+
+	for (uint32_t i = 0; i < retired->nrecorded_cmds; i++) {
+		vkFreeCommandBuffers(vk->device, app->cmd_pool, 1,
+				&retired->recorded_cmds[i].cmd);
+	}
+	free(retired->recorded_cmds);
+	free(retired);
+}
+
+/* destroys what the gpu is done with, or everything once the device is idle */
+static void
+release_retired_swapchains(struct app *app, bool idle) {
+	uint64_t completed = UINT64_MAX;
+	if (!idle) {
+		VkResult res = vkGetSemaphoreCounterValue(app->vk->device,
+				app->render_timeline, &completed);
+		assert(res == VK_SUCCESS);
+	}
+
+	struct retired_swapchain **link = &app->retired_swapchains;
+	while (*link != NULL) {
+		struct retired_swapchain *retired = *link;
+		if (retired->release_value <= completed) {
+			*link = retired->next;
+			destroy_retired_swapchain(app, retired);
+		} else {
+			link = &retired->next;
+		}
+	}
+}
+
+/* the extent a swapchain created now would get */
+static VkExtent2D
+surface_extent(struct app *app) {
+	VkSurfaceCapabilitiesKHR surface_caps;
+	VkResult res = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(app->vk->physical_device,
+			app->surface, &surface_caps);
+	if (res != VK_SUCCESS || surface_caps.currentExtent.width == UINT32_MAX) {
+		/* the surface leaves it to the swapchain, which follows the window */
+		return (VkExtent2D) { app->window->width, app->window->height };
+	}
+	return surface_caps.currentExtent;
+}
+
+/*
+ * replaces the swapchain along with everything sized after it, unless the
+ * surface still has the swapchain's extent. the old ones are retired rather
+ * than destroyed, so no frame in flight has to finish first.
+ */
+static VkResult
+recreate_swapchain(struct app *app) {
+	TRACE_SCOPE("recreate_swapchain");
+	VkExtent2D extent = surface_extent(app);
+	if (!app->swapchain_out_of_date && extent.width == app->swapchain.extent.width
+			&& extent.height == app->swapchain.extent.height) {
+		return VK_SUCCESS;
+	}
+
+	struct retired_swapchain *retired = calloc(1, sizeof(struct retired_swapchain));
+	if (retired == NULL) {
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+	/*
+	 * presents can't be waited on, but the queue takes them in order: once
+	 * the frames in flight after this one are done, so are the old presents
+	 */
+	retired->release_value = app->frames_submitted + app->nframes;
+	retired->swapchain = app->swapchain;
+	retired->scale_targets = app->scale_targets;
+	retired->scale_descriptor_pool = app->scale_descriptor_pool;
+	retired->scale_descriptor_sets = app->scale_descriptor_sets;
+	retired->nrecorded_cmds = app->nrecorded_cmds;
+	retired->recorded_cmds = app->recorded_cmds;
+	retired->next = app->retired_swapchains;
+	app->retired_swapchains = retired;
+
+	/* create_swapchain only needs the old handle, to pass it on */
+	app->swapchain.nimages = 0;
+	app->swapchain.images = NULL;
+	app->scale_targets = (struct swapchain) { 0 };
+	app->scale_descriptor_pool = VK_NULL_HANDLE;
+	app->scale_descriptor_sets = NULL;
+	app->nrecorded_cmds = 0;
+	app->recorded_cmds = NULL;
+
+	/* presents queued on the old swapchain can't be waited on anymore */
+	pacer_drop_pending(&app->pacer);
+
+	VkResult res = create_swapchain(app->vk, app->surface, app->render_pass,
+			&app->swapchain);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+	if (scale_filter_separable(app->filter)) {
+		res = create_scale_targets(app);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+	}
+	res = allocate_recorded_cmds(app);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	app->swapchain_out_of_date = false;
+	app->frame_stats.swapchain_recreations++;
+	return VK_SUCCESS;
+}
+
+/* input_ns is when the frame was due, or when the event that asked for it arrived */
+static void
+app_render(struct app *app, uint64_t input_ns) {
+	TRACE_SCOPE("app_render");
 	struct vulkan_ctx *vk = app->vk;
+	struct frame_context *frame = &app->frames[app->frame_index];
+	struct frame_stats *stats = &app->frame_stats;
 	VkResult res = VK_SUCCESS;
 
-	res = vkWaitForFences(vk->device, 1, &app->inflight_fence, VK_TRUE, UINT64_MAX);
-	assert(res == VK_SUCCESS);
-	res = vkResetFences(vk->device, 1, &app->inflight_fence);
+	uint64_t start = now_ns();
+	if (vk->present_wait) {
+		/* pacing to the display starts frames right after the last refresh */
+		collect_presents(app, app->pacer.mode == PACER_MODE_DISPLAY
+				? PRESENT_WAIT_TIMEOUT_NS : 0);
+	}
+
+	uint64_t fence_wait_start = now_ns();
+	res = vkWaitForFences(vk->device, 1, &frame->inflight_fence, VK_TRUE, UINT64_MAX);
 	assert(res == VK_SUCCESS);
+	uint64_t fence_wait_end = now_ns();
+	trace_cpu("vkWaitForFences", fence_wait_start, fence_wait_end);
+	uint64_t wait_ns = fence_wait_end - start;
+
+	if (app->retired_swapchains != NULL) {
+		release_retired_swapchains(app, false);
+	}
+
+	struct frame_slot *slot = playback_advance(app);
 
 	uint32_t image_ind = 0;
-	res = acquire_next_image(app, &image_ind);
+	if (app->swapchain.offscreen) {
+		res = VK_SUCCESS;
+		image_ind = app->frames_submitted % app->swapchain.nimages;
+	} else {
+		res = acquire_next_image(app, frame->image_acquisition_semaphore, &image_ind);
+	}
 	if (res == VK_ERROR_OUT_OF_DATE_KHR) {
+		/* draw again once the swapchain matches the window */
+		app->swapchain_out_of_date = true;
+		app->window->resized = true;
 		return;
 	}
 	assert(res == VK_SUCCESS || res == VK_SUBOPTIMAL_KHR);
 
-	res = build_cmd_buffer_for_fb(app, app->cmd, app->swapchain.images[image_ind].framebuffer);
+	/* an earlier frame may still be rendering into this swapchain image */
+	struct swapchain_image *swapchain_image = &app->swapchain.images[image_ind];
+	if (swapchain_image->inflight_fence != VK_NULL_HANDLE
+			&& swapchain_image->inflight_fence != frame->inflight_fence) {
+		uint64_t image_wait_start = now_ns();
+		res = vkWaitForFences(vk->device, 1, &swapchain_image->inflight_fence,
+				VK_TRUE, UINT64_MAX);
+		assert(res == VK_SUCCESS);
+		uint64_t image_wait_end = now_ns();
+		trace_cpu("vkWaitForFences", image_wait_start, image_wait_end);
+		wait_ns += image_wait_end - image_wait_start;
+	}
+	swapchain_image->inflight_fence = frame->inflight_fence;
+
+	/* only reset once we know a submission will signal the fence again */
+	res = vkResetFences(vk->device, 1, &frame->inflight_fence);
 	assert(res == VK_SUCCESS);
 
+	VkCommandBuffer cmds[3] = { VK_NULL_HANDLE, get_recorded_cmd(app, image_ind, slot) };
+	uint32_t ncmds = 1;
+	bool timed = gpu_timer_enabled(&app->gpu_timer);
+	if (timed) {
+		/* the fence wait above retired the last use of this timestamp set */
+		record_timing_cmds(app, app->frame_index);
+		cmds[0] = frame->timing_cmds[0];
+		cmds[2] = frame->timing_cmds[1];
+		ncmds = 3;
+	}
+
+	/*
+	 * binary semaphores ignore their entry in the timeline values. offscreen
+	 * targets are neither acquired nor presented, so only the timeline is used.
+	 */
+	bool presenting = !app->swapchain.offscreen;
+	uint64_t signal_values[2] = { app->frames_submitted + 1, 0 };
+	VkSemaphore signal_semaphores[2] = {
+		app->render_timeline,
+		swapchain_image->rendering_semaphore,
+	};
+	VkTimelineSemaphoreSubmitInfo timeline_info = {
+		.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		.signalSemaphoreValueCount = presenting ? 2 : 1,
+		.pSignalSemaphoreValues = signal_values,
+	};
 	VkPipelineStageFlags dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	VkSubmitInfo submit_info = {
 		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &app->image_acquisition_semaphore,
+		.pNext = &timeline_info,
+		.waitSemaphoreCount = presenting ? 1 : 0,
+		.pWaitSemaphores = &frame->image_acquisition_semaphore,
 		.pWaitDstStageMask = &dst_stage_mask,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &app->cmd,
-		.signalSemaphoreCount = 1,
-		.pSignalSemaphores = &app->rendering_semaphore,
+		.commandBufferCount = ncmds,
+		.pCommandBuffers = timed ? cmds : &cmds[1],
+		.signalSemaphoreCount = presenting ? 2 : 1,
+		.pSignalSemaphores = signal_semaphores,
 	};
-	vkQueueSubmit(vk->queue, 1, &submit_info, app->inflight_fence);
+	res = vkQueueSubmit(vk->queue, 1, &submit_info, frame->inflight_fence);
+	assert(res == VK_SUCCESS);
+	app->frames_submitted++;
+	slot->last_use = app->frames_submitted;
+
+	if (presenting) {
+		/* the timeline value doubles as the present id, both only grow */
+		VkPresentIdKHR present_id = {
+			.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+			.swapchainCount = 1,
+			.pPresentIds = &app->frames_submitted,
+		};
+		VkPresentInfoKHR present_info = {
+			.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+			.pNext = vk->present_wait ? &present_id : NULL,
+			.waitSemaphoreCount = 1,
+			.pWaitSemaphores = &swapchain_image->rendering_semaphore,
+			.swapchainCount = 1,
+			.pSwapchains = &app->swapchain.vk_swapchain,
+			.pImageIndices = &image_ind,
+			.pResults = NULL,
+		};
+		res = vkQueuePresentKHR(vk->queue, &present_info);
+		if (res == VK_ERROR_OUT_OF_DATE_KHR) {
+			app->swapchain_out_of_date = true;
+			app->window->resized = true;
+		} else if (res == VK_SUCCESS || res == VK_SUBOPTIMAL_KHR) {
+			pacer_frame_queued(&app->pacer, app->frames_submitted, input_ns,
+					start, now_ns());
+			/* without present_wait, queueing the present is the best we know */
+			if (!vk->present_wait) {
+				pacer_frame_presented(&app->pacer, now_ns());
+			}
+		}
+	}
+
+	/* the gpu is sampling the current slot, refill the others meanwhile */
+	playback_fill_ahead(app);
+
+	app->frame_index = (app->frame_index + 1) % app->nframes;
+
+	uint64_t frame_ns = now_ns() - start;
+	if (stats->frames == 0) {
+		app->first_frame_ns = now_ns() - app->launch_ns;
+	}
+	stats->frames++;
+	stats->frame_ns += frame_ns;
+	stats->wait_ns += wait_ns;
+	if (frame_ns > stats->max_frame_ns) {
+		stats->max_frame_ns = frame_ns;
+	}
+
+	if (app->timing_interval > 0 && stats->frames % app->timing_interval == 0) {
+		gpu_timings_print(&app->gpu_timings);
+	}
+}
+
+/*
+ * gives a tile of the slot its image, and with compute conversion the rgba
+ * image it is converted into
+ */
+static VkResult
+upload_slot_tile(struct app *app, struct app_params *params, struct frame_slot *slot,
+		uint32_t tile_index) {
+	struct vulkan_ctx *vk = app->vk;
+	struct playback *playback = &app->playback;
+	struct slot_tile *tile = &slot->tiles[tile_index];
+	VkResult res;
+
+	uint32_t frame = playback_tile_frame(playback, slot->frame, tile_index);
+	res = image_pool_acquire(&app->image_pool, vk, &app->uploader,
+			&app->sampler, sequence_frame(&playback->sequence, frame),
+			params->width, params->height, params->format, params->disjoint,
+			&tile->image);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	/* staging uploads already leave the image ready for sampling */
+	struct image *image = &tile->image->image;
+	if (image->layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+		res = transition_image_layout(vk, app->cmd_pool, image->vk_image);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+		image->layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+
+	if (app->sampler.mode != IMAGE_CONVERSION_COMPUTE) {
+		return VK_SUCCESS;
+	}
+	return create_convert_target(vk, params->width, params->height, tile);
+}
+
+/*
+ * points the slot's descriptors at the images of a tile, a single stream is
+ * drawn from the slot's set. needs the descriptor set layouts of the pipelines.
+ */
+static VkResult
+bind_slot_tile(struct app *app, struct frame_slot *slot, uint32_t tile_index) {
+	struct vulkan_ctx *vk = app->vk;
+	struct slot_tile *tile = &slot->tiles[tile_index];
+	bool single = app->playback.ntiles == 1;
+	VkResult res;
+
+	if (app->sampler.mode != IMAGE_CONVERSION_COMPUTE) {
+		update_descriptor_with_image(vk, slot->descriptor_set, 0,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, app->sampler.sampler,
+				tile->image->view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		return VK_SUCCESS;
+	}
+
+	if (single) {
+		update_descriptor_with_image(vk, slot->descriptor_set, 0,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, app->sampler.sampler,
+				tile->rgb_view, VK_IMAGE_LAYOUT_GENERAL);
+	}
+
+	res = allocate_descriptor_set(vk, &tile->convert_descriptor_set,
+			app->descriptor_pool, app->convert.descriptor_set_layout);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+	/* nv12 has no third plane, its second one is bound there too */
+	struct image *image = &tile->image->image;
+	for (uint32_t plane = 0; plane < 3; plane++) {
+		uint32_t view = plane < image->plane_count ? plane : 1;
+		update_descriptor_with_image(vk, tile->convert_descriptor_set, plane,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, app->sampler.sampler,
+				tile->image->plane_views[view],
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+	update_descriptor_with_image(vk, tile->convert_descriptor_set, 3,
+			VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_NULL_HANDLE,
+			tile->rgb_view, VK_IMAGE_LAYOUT_GENERAL);
+	return VK_SUCCESS;
+}
+
+/* every entry of the image array is written, those past the tiles repeat the last */
+static void
+update_wall_descriptor(struct app *app, struct frame_slot *slot) {
+	uint32_t ntiles = app->playback.ntiles;
+	VkDescriptorImageInfo image_infos[WALL_MAX_TILES];
+	for (uint32_t i = 0; i < WALL_MAX_TILES; i++) {
+		uint32_t tile = i < ntiles ? i : ntiles - 1;
+		image_infos[i] = (VkDescriptorImageInfo) {
+			.sampler = app->sampler.sampler,
+			.imageView = slot->tiles[tile].rgb_view,
+			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+	}
 
-	VkPresentInfoKHR present_info = {
-		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &app->rendering_semaphore,
-		.swapchainCount = 1,
-		.pSwapchains = &app->swapchain.vk_swapchain,
-		.pImageIndices = &image_ind,
-		.pResults = NULL,
+	VkWriteDescriptorSet writes[2] = {
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = slot->descriptor_set,
+			.dstBinding = 0,
+			.dstArrayElement = 0,
+			.descriptorCount = WALL_MAX_TILES,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.pImageInfo = image_infos,
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = slot->descriptor_set,
+			.dstBinding = 1,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pBufferInfo = &(VkDescriptorBufferInfo) {
+				.buffer = app->wall.rect_buffer,
+				.offset = 0,
+				.range = VK_WHOLE_SIZE,
+			},
+		},
 	};
-	res = vkQueuePresentKHR(vk->queue, &present_info);
+	vkUpdateDescriptorSets(app->vk->device, 2, writes, 0, NULL);
 }
 
-void
-app_init(struct app *ini, struct app_params *params, struct vulkan_ctx *vk) {
-	ini->vk = vk;
+/* the window and its swapchain, or the offscreen targets rendered into instead */
+static VkResult
+create_render_targets(struct app *app, struct app_params *params) {
+	TRACE_SCOPE("create_render_targets");
+	struct vulkan_ctx *vk = app->vk;
+	VkResult res;
 
-	struct window *window = window_create();
-	ini->window = window;
+	if (params->headless) {
+		/* a target per frame in flight, the size of the frames unless asked otherwise */
+		VkExtent2D extent = {
+			.width = params->output_width > 0 ? params->output_width : params->width,
+			.height = params->output_height > 0 ? params->output_height : params->height,
+		};
+		res = create_offscreen_targets(vk, app->render_pass, extent,
+				params->nframes, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, &app->swapchain);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+		printf("rendering headless into %u %ux%u targets\n",
+				app->swapchain.nimages, extent.width, extent.height);
+		return VK_SUCCESS;
+	}
 
-	VkResult res = VK_SUCCESS;
+	struct window *window = window_create();
+	app->window = window;
 
 	VkXcbSurfaceCreateInfoKHR xcb_surface_create_info = {
 		.sType = VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO_KHR,
 		.connection = window->xcb_connection,
 		.window = window->window_id,
 	};
-	res = vkCreateXcbSurfaceKHR(vk->instance, &xcb_surface_create_info, NULL, &ini->surface);
-	assert(res == VK_SUCCESS);
+	res = vkCreateXcbSurfaceKHR(vk->instance, &xcb_surface_create_info, NULL, &app->surface);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
 
-	res = create_renderpass(vk, &ini->render_pass);
-	assert(res == VK_SUCCESS);
+	app->swapchain.requested_present_mode = params->present_mode;
+	app->swapchain.requested_nimages = params->nimages;
+	res = create_swapchain(vk, app->surface, app->render_pass, &app->swapchain);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+	printf("presenting %u images in %s mode\n", app->swapchain.nimages,
+			present_mode_name(app->swapchain.present_mode));
+	return VK_SUCCESS;
+}
 
-	res = create_swapchain(vk, ini->surface, ini->render_pass, &ini->swapchain);
-	assert(res == VK_SUCCESS);
+static VkResult
+create_pipelines(struct app *app, struct app_params *params) {
+	TRACE_SCOPE("create_pipelines");
+	struct vulkan_ctx *vk = app->vk;
+	VkResult res;
 
-	res = vulkan_ctx_create_semaphore(vk, &ini->image_acquisition_semaphore);
-	assert(res == VK_SUCCESS);
+	if (params->conversion == IMAGE_CONVERSION_COMPUTE) {
+		res = convert_pipeline_init(&app->convert, vk, app->sampler.sampler,
+				params->format, params->color_model, params->color_range);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+	}
 
-	res = vulkan_ctx_create_semaphore(vk, &ini->rendering_semaphore);
-	assert(res == VK_SUCCESS);
+	if (app->playback.ntiles > 1) {
+		res = wall_pipeline_init(&app->wall_pipeline, vk, app->sampler.sampler,
+				app->render_pass);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+	}
+
+	res = graphics_pipeline_init(&app->pipeline, vk,
+			app->descriptor_set_layout, app->render_pass);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	if (scale_filter_separable(app->filter)) {
+		res = scale_pipeline_init(&app->scale, vk, app->filter,
+				app->descriptor_set_layout, app->scale_render_pass, app->render_pass);
+	}
+	return res;
+}
+
+/* the first frames of every slot, faulted in from the mapping and uploaded */
+static VkResult
+upload_slots(struct app *app, struct app_params *params) {
+	TRACE_SCOPE("upload_slots");
+	struct playback *playback = &app->playback;
+
+	for (uint32_t i = 0; i < playback->nslots; i++) {
+		struct frame_slot *slot = &playback->slots[i];
+		slot->frame = i % playback->sequence.frame_count;
+
+		for (uint32_t tile = 0; tile < playback->ntiles; tile++) {
+			VkResult res = upload_slot_tile(app, params, slot, tile);
+			if (res != VK_SUCCESS) {
+				return res;
+			}
+		}
+	}
+	return VK_SUCCESS;
+}
+
+static const char *startup_task_names[STARTUP_TASK_COUNT] = {
+	[STARTUP_TASK_RENDER_TARGETS] = "render targets",
+	[STARTUP_TASK_PIPELINES] = "pipelines",
+	[STARTUP_TASK_UPLOADS] = "uploads",
+};
+
+struct startup_job {
+	enum startup_task task;
+	struct app *app;
+	struct app_params *params;
+	VkResult res;
+};
+
+static void
+run_startup_job(void *data) {
+	struct startup_job *job = data;
+	uint64_t start = now_ns();
+	switch (job->task) {
+		case STARTUP_TASK_RENDER_TARGETS:
+			job->res = create_render_targets(job->app, job->params);
+			break;
+		case STARTUP_TASK_PIPELINES:
+			job->res = create_pipelines(job->app, job->params);
+			break;
+		case STARTUP_TASK_UPLOADS:
+			job->res = upload_slots(job->app, job->params);
+			break;
+		default:
+			job->res = VK_ERROR_UNKNOWN;
+			break;
+	}
+	job->app->startup_task_ns[job->task] = now_ns() - start;
+}
+
+/*
+ * once the device exists, the window and swapchain, the pipelines and the
+ * uploads of the first frames only depend on what app_init creates before
+ * them, so they run on threads of their own and join here
+ */
+static void
+run_startup_tasks(struct app *app, struct app_params *params) {
+	TRACE_SCOPE("run_startup_tasks");
+	struct startup_job jobs[STARTUP_TASK_COUNT];
+	for (int task = 0; task < STARTUP_TASK_COUNT; task++) {
+		jobs[task] = (struct startup_job) {
+			.task = task,
+			.app = app,
+			.params = params,
+		};
+	}
+
+	/* a pool of one runs the jobs in turn on this thread */
+	struct worker_pool pool;
+	int ret = worker_pool_init(&pool,
+			params->serial_startup ? 1 : STARTUP_TASK_COUNT);
+	assert(ret == 0);
+	worker_pool_run(&pool, run_startup_job, jobs, sizeof(struct startup_job),
+			STARTUP_TASK_COUNT);
+	app->serial_startup = pool.nworkers == 1;
+	worker_pool_finish(&pool);
+
+	for (int task = 0; task < STARTUP_TASK_COUNT; task++) {
+		if (jobs[task].res != VK_SUCCESS) {
+			fprintf(stderr, "run_startup_tasks - %s failed (%d)\n",
+					startup_task_names[task], jobs[task].res);
+		}
+		assert(jobs[task].res == VK_SUCCESS);
+	}
+}
+
+void
+app_init(struct app *ini, struct app_params *params, struct vulkan_ctx *vk) {
+	uint64_t init_start = now_ns();
+	ini->vk = vk;
+
+	VkResult res = VK_SUCCESS;
 
-	res = vulkan_ctx_create_fence(vk, &ini->inflight_fence, true);
+	res = create_renderpass(vk, &ini->render_pass, params->headless
+			? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 	assert(res == VK_SUCCESS);
 
+	pacer_init(&ini->pacer, params->pacing);
+
 	res = vulkan_ctx_create_cmd_pool(vk, &ini->cmd_pool,
 			VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 	assert(res == VK_SUCCESS);
 
-	res = create_command_buffer(vk, ini->cmd_pool, &ini->cmd);
+	gpu_timings_init(&ini->gpu_timings);
+	ini->timing_interval = params->timing_interval;
+	ini->report_path = params->report_path;
+	res = gpu_timer_init(&ini->gpu_timer, vk, &ini->gpu_timings, params->nframes);
 	assert(res == VK_SUCCESS);
 
-	res = image_init_from_file(&ini->image, vk, params->image_path,
-			params->width, params->height, params->format, params->disjoint);
-	assert(res == VK_SUCCESS);
+	ini->nframes = params->nframes;
+	ini->frame_index = 0;
+	for (uint32_t i = 0; i < ini->nframes; i++) {
+		struct frame_context *frame = &ini->frames[i];
+
+		res = vulkan_ctx_create_semaphore(vk, &frame->image_acquisition_semaphore);
+		assert(res == VK_SUCCESS);
+
+		res = vulkan_ctx_create_fence(vk, &frame->inflight_fence, true);
+		assert(res == VK_SUCCESS);
+
+		if (gpu_timer_enabled(&ini->gpu_timer)) {
+			for (uint32_t cmd = 0; cmd < 2; cmd++) {
+				res = create_command_buffer(vk, ini->cmd_pool, &frame->timing_cmds[cmd]);
+				assert(res == VK_SUCCESS);
+			}
+		}
+	}
 
-	res = image_sampler_init(&ini->sampler, vk, params->format);
+	/* frames in flight are retired on the render timeline, there is no fallback */
+	res = vulkan_ctx_create_timeline_semaphore(vk, &ini->render_timeline, 0);
+	if (res == VK_ERROR_FEATURE_NOT_PRESENT) {
+		fprintf(stderr, "app_init - timelineSemaphore not supported\n");
+		exit(EXIT_FAILURE);
+	}
 	assert(res == VK_SUCCESS);
+	ini->frames_submitted = 0;
+
+	struct playback *playback = &ini->playback;
+	printf("playing %u frames at %.2f fps\n",
+			playback->sequence.frame_count, params->fps);
+	playback->fps = params->fps;
+	playback->unpaced = params->headless;
+	playback->nslots = params->nslots;
+	playback->ntiles = params->ntiles;
+	playback->current = UINT64_MAX;
+
+	int ret = readahead_init(&playback->readahead, &playback->sequence,
+			params->readahead_depth);
+	if (ret == -1) {
+		fprintf(stderr, "app_init - failed to start read-ahead... "
+				"faulting frames in on upload\n");
+	}
 
-	res = create_image_view(vk, &ini->image_view, &ini->image, &ini->sampler);
+	res = image_sampler_init(&ini->sampler, vk, params->format,
+			params->conversion, params->color_model, params->color_range,
+			params->sampler_filter);
 	assert(res == VK_SUCCESS);
-	res = transition_image_layout(vk, ini->cmd_pool, ini->image.vk_image);
+
+	/* room for a frame per tile of every slot, with slack for row pitch alignment */
+	VkDeviceSize staging_size = 2 * playback->nslots * playback->ntiles
+		* image_format_size(params->format, params->width, params->height);
+	res = image_uploader_init(&ini->uploader, vk, params->upload_mode,
+			staging_size, params->nworkers);
 	assert(res == VK_SUCCESS);
 
-	res = create_descriptor_pool(vk, &ini->descriptor_pool);
+	/* let the gpu copy frames out of the file mapping when it can */
+	if (ini->uploader.mode == IMAGE_UPLOAD_MODE_STAGING && vk->external_memory_host) {
+		res = image_uploader_import_host(&ini->uploader, vk,
+				playback->sequence.mapped_ptr, playback->sequence.mapped_size);
+		if (res != VK_SUCCESS) {
+			fprintf(stderr, "app_init - failed to import the sequence... "
+					"copying frames through the staging ring\n");
+		}
+	}
+
+	if (ini->uploader.mode == IMAGE_UPLOAD_MODE_STAGING) {
+		res = image_uploader_enable_timing(&ini->uploader, vk, &ini->gpu_timings);
+		assert(res == VK_SUCCESS);
+	}
+
+	image_pool_init(&ini->image_pool, IMAGE_POOL_DEFAULT_IDLE_BUDGET);
+
+	bool compute = params->conversion == IMAGE_CONVERSION_COMPUTE;
+	res = create_descriptor_pool(vk, &ini->descriptor_pool, playback->nslots,
+			playback->ntiles, compute);
 	assert(res == VK_SUCCESS);
 
 	res = create_descriptor_set_layout(vk, &ini->descriptor_set_layout,
 			ini->sampler.sampler);
 	assert(res == VK_SUCCESS);
 
-	res = allocate_descriptor_set(vk, &ini->descriptor_set,
-			ini->descriptor_pool, ini->descriptor_set_layout);
-	assert(res == VK_SUCCESS);
+	bool wall = playback->ntiles > 1;
+	if (wall) {
+		res = wall_init(&ini->wall, vk, playback->ntiles);
+		assert(res == VK_SUCCESS);
+		printf("showing %u streams in %u columns and %u rows\n", playback->ntiles,
+				ini->wall.columns, ini->wall.rows);
+	}
+
+	ini->filter = params->filter;
+	if (scale_filter_separable(ini->filter)) {
+		res = create_renderpass(vk, &ini->scale_render_pass,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		assert(res == VK_SUCCESS);
+	}
+
+	run_startup_tasks(ini, params);
 
-	update_descriptor_with_image(vk, ini->descriptor_set, ini->sampler.sampler,
-			ini->image_view);
+	for (uint32_t i = 0; i < playback->nslots; i++) {
+		struct frame_slot *slot = &playback->slots[i];
+		res = allocate_descriptor_set(vk, &slot->descriptor_set, ini->descriptor_pool,
+				wall ? ini->wall_pipeline.descriptor_set_layout
+				: ini->descriptor_set_layout);
+		assert(res == VK_SUCCESS);
 
-	res = graphics_pipeline_init(&ini->pipeline, vk,
-			ini->descriptor_set_layout, ini->render_pass);
+		for (uint32_t tile = 0; tile < playback->ntiles; tile++) {
+			res = bind_slot_tile(ini, slot, tile);
+			assert(res == VK_SUCCESS);
+		}
+		if (wall) {
+			update_wall_descriptor(ini, slot);
+		}
+	}
+
+	if (scale_filter_separable(ini->filter)) {
+		res = create_scale_targets(ini);
+		assert(res == VK_SUCCESS);
+	}
+
+	res = allocate_recorded_cmds(ini);
 	assert(res == VK_SUCCESS);
+	ini->init_ns = now_ns() - init_start;
 }
 
 void
 app_finish(struct app *app) {
+	/* the run left the device idle */
+	release_retired_swapchains(app, true);
+
 	graphics_pipeline_finish(&app->pipeline, app->vk);
+	if (app->sampler.mode == IMAGE_CONVERSION_COMPUTE) {
+		convert_pipeline_finish(&app->convert, app->vk);
+	}
+	if (scale_filter_separable(app->filter)) {
+		destroy_scale_targets(app);
+		scale_pipeline_finish(&app->scale, app->vk);
+		vkDestroyRenderPass(app->vk->device, app->scale_render_pass, NULL);
+	}
+	if (app->playback.ntiles > 1) {
+		wall_pipeline_finish(&app->wall_pipeline, app->vk);
+		wall_finish(&app->wall, app->vk);
+	}
 
 	vkDestroyDescriptorSetLayout(app->vk->device, app->descriptor_set_layout, NULL);
 	vkDestroyDescriptorPool(app->vk->device, app->descriptor_pool, NULL);
 
-	vkDestroyImageView(app->vk->device, app->image_view, NULL);
-	image_finish(&app->image, app->vk);
+	for (uint32_t i = 0; i < app->playback.nslots; i++) {
+		struct frame_slot *slot = &app->playback.slots[i];
+		for (uint32_t tile = 0; tile < app->playback.ntiles; tile++) {
+			image_pool_release(&app->image_pool, app->vk, slot->tiles[tile].image);
+			slot->tiles[tile].image = NULL;
+			if (slot->tiles[tile].rgb_image != VK_NULL_HANDLE) {
+				destroy_convert_target(app->vk, &slot->tiles[tile]);
+			}
+		}
+	}
+	image_pool_finish(&app->image_pool, app->vk);
+	image_uploader_finish(&app->uploader, app->vk);
+	readahead_finish(&app->playback.readahead);
+	sequence_close(&app->playback.sequence);
 	image_sampler_finish(&app->sampler, app->vk);
 
-	vkDestroyFence(app->vk->device, app->inflight_fence, NULL);
-	vkDestroySemaphore(app->vk->device, app->rendering_semaphore, NULL);
-	vkDestroySemaphore(app->vk->device, app->image_acquisition_semaphore, NULL);
-
-	vkFreeCommandBuffers(app->vk->device, app->cmd_pool, 1, &app->cmd);
+	free_recorded_cmds(app);
+	vkDestroySemaphore(app->vk->device, app->render_timeline, NULL);
+	gpu_timer_finish(&app->gpu_timer, app->vk);
+	for (uint32_t i = 0; i < app->nframes; i++) {
+		struct frame_context *frame = &app->frames[i];
+		if (frame->timing_cmds[0] != VK_NULL_HANDLE) {
+			vkFreeCommandBuffers(app->vk->device, app->cmd_pool, 2, frame->timing_cmds);
+		}
+		vkDestroyFence(app->vk->device, frame->inflight_fence, NULL);
+		vkDestroySemaphore(app->vk->device, frame->image_acquisition_semaphore, NULL);
+	}
 	vkDestroyCommandPool(app->vk->device, app->cmd_pool, NULL);
 
+	bool offscreen = app->swapchain.offscreen;
 	destroy_swapchain_related_resources(app->vk, &app->swapchain);
-	vkDestroySwapchainKHR(app->vk->device, app->swapchain.vk_swapchain, NULL);
+	if (!offscreen) {
+		vkDestroySwapchainKHR(app->vk->device, app->swapchain.vk_swapchain, NULL);
+	}
 
 	vkDestroyRenderPass(app->vk->device, app->render_pass, NULL);
-	vkDestroySurfaceKHR(app->vk->instance, app->surface, NULL);
 
-	window_destroy(app->window);
+	/* headless contexts don't have the surface extension loaded */
+	if (app->window != NULL) {
+		vkDestroySurfaceKHR(app->vk->instance, app->surface, NULL);
+		window_destroy(app->window);
+	}
 	vulkan_ctx_destroy(app->vk);
 }
 
+static const char *
+image_format_name(enum image_format format) {
+	switch (format) {
+		case IMAGE_FORMAT_YU12:
+			return "yu12";
+		case IMAGE_FORMAT_NV12:
+			return "nv12";
+		case IMAGE_FORMAT_422P:
+			return "422p";
+	}
+	return "unknown";
+}
+
+static const char *
+scale_filter_name(enum scale_filter filter) {
+	switch (filter) {
+		case SCALE_FILTER_NEAREST:
+			return "nearest";
+		case SCALE_FILTER_BILINEAR:
+			return "bilinear";
+		case SCALE_FILTER_BICUBIC:
+			return "bicubic";
+		case SCALE_FILTER_LANCZOS:
+			return "lanczos";
+	}
+	return "unknown";
+}
+
+static const char *
+pipeline_cache_state(struct vulkan_ctx *vk) {
+	if (vk->pipeline_cache == VK_NULL_HANDLE) {
+		return "none";
+	}
+	return vk->pipeline_cache_warm ? "warm" : "cold";
+}
+
+/* averages in milliseconds, 0 where nothing was measured */
+static double
+average_ms(double total_ns, uint64_t count) {
+	return count > 0 ? total_ns / 1e6 / count : 0.0;
+}
+
+/*
+ * value as the contents of a json string, out needs room for 6 bytes per
+ * byte of value. utf-8 passes through as is.
+ */
+static void
+json_escape(char *out, const char *value) {
+	for (; *value != '\0'; value++) {
+		unsigned char c = *value;
+		if (c == '"' || c == '\\') {
+			*out++ = '\\';
+			*out++ = c;
+		} else if (c < 0x20) {
+			out += sprintf(out, "\\u%04x", c);
+		} else {
+			*out++ = c;
+		}
+	}
+	*out = '\0';
+}
+
+/* one json object per line, so runs of several commits can share a file */
+static void
+app_write_report(struct app *app, uint64_t frames_rendered, double elapsed) {
+	FILE *file = fopen(app->report_path, "a");
+	if (file == NULL) {
+		perror("app_write_report - fopen");
+		return;
+	}
+
+	const struct sequence *sequence = &app->playback.sequence;
+	const struct image_upload_stats *upload_stats = &app->uploader.stats;
+	const struct gpu_stage_stats *gpu_stages = app->gpu_timings.stages;
+	char device[6 * VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+	json_escape(device, app->vk->physical_device_properties.deviceName);
+	fprintf(file, "{\"time\":%lld,\"device\":\"%s\",\"format\":\"%s\","
+			"\"width\":%u,\"height\":%u,\"disjoint\":%s,\"upload\":\"%s\","
+			"\"conversion\":\"%s\",\"filter\":\"%s\","
+			"\"output_width\":%u,\"output_height\":%u,\"tiles\":%u,"
+			"\"workers\":%u,\"frames\":%" PRIu64 ",\"seconds\":%.3f,"
+			"\"fps\":%.2f,\"frame_ms\":%.3f,\"upload_ms\":%.3f,"
+			"\"upload_wait_ms\":%.3f,\"uploads\":%" PRIu64 ","
+			"\"zero_copy\":%" PRIu64 ","
+			"\"gpu_upload_ms\":%.3f,\"gpu_frame_ms\":%.3f,"
+			"\"first_frame_ms\":%.3f,\"pipeline_cache\":\"%s\","
+			"\"init_ms\":%.3f,\"startup\":\"%s\"}\n",
+			(long long) time(NULL), device,
+			image_format_name(sequence->format), sequence->width, sequence->height,
+			app->playback.slots[0].tiles[0].image->key.disjoint ? "true" : "false",
+			app->uploader.mode == IMAGE_UPLOAD_MODE_STAGING ? "staging" : "linear",
+			app->sampler.mode == IMAGE_CONVERSION_COMPUTE ? "compute" : "sampler",
+			scale_filter_name(app->filter), app->swapchain.extent.width,
+			app->swapchain.extent.height, app->playback.ntiles,
+			app->uploader.workers.nworkers, frames_rendered, elapsed,
+			frames_rendered / elapsed,
+			average_ms(app->frame_stats.frame_ns, app->frame_stats.frames),
+			average_ms(upload_stats->total_ns, upload_stats->count),
+			average_ms(upload_stats->wait_ns, upload_stats->count),
+			upload_stats->count, upload_stats->zero_copy,
+			average_ms(gpu_stages[GPU_STAGE_UPLOAD_COPY].total_ns,
+				gpu_stages[GPU_STAGE_UPLOAD_COPY].count),
+			average_ms(gpu_stages[GPU_STAGE_FRAME].total_ns,
+				gpu_stages[GPU_STAGE_FRAME].count),
+			app->first_frame_ns / 1e6, pipeline_cache_state(app->vk),
+			app->init_ns / 1e6, app->serial_startup ? "serial" : "parallel");
+	fclose(file);
+}
+
+static void
+app_print_stats(struct app *app, uint64_t frames_rendered,
+		const struct timespec *cpu_start) {
+	struct vulkan_ctx *vk = app->vk;
+	double elapsed = (now_ns() - app->playback.start_ns) / 1e9;
+	struct timespec cpu_end;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end);
+	double cpu_elapsed = (cpu_end.tv_sec - cpu_start->tv_sec)
+		+ (cpu_end.tv_nsec - cpu_start->tv_nsec) / 1e9;
+	memory_allocator_print_stats(&vk->allocator);
+	printf("rendered %" PRIu64 " frames of %u streams in %.2fs (%.1f fps, "
+			"%s upload, %s conversion, %s scaling)\n", frames_rendered,
+			app->playback.ntiles, elapsed, frames_rendered / elapsed,
+			app->uploader.mode == IMAGE_UPLOAD_MODE_STAGING ? "staging" : "linear",
+			app->sampler.mode == IMAGE_CONVERSION_COMPUTE ? "compute" : "sampler",
+			scale_filter_name(app->filter));
+
+	printf("used %.2fs of cpu time, %.1f%% of a core\n",
+			cpu_elapsed, cpu_elapsed / elapsed * 100.0);
+	printf("first frame submitted %.3fms after launch (%s pipeline cache)\n",
+			app->first_frame_ns / 1e6, pipeline_cache_state(vk));
+	printf("app_init took %.3fms, with %s %.3fms, %s %.3fms and %s %.3fms %s\n",
+			app->init_ns / 1e6,
+			startup_task_names[STARTUP_TASK_RENDER_TARGETS],
+			app->startup_task_ns[STARTUP_TASK_RENDER_TARGETS] / 1e6,
+			startup_task_names[STARTUP_TASK_PIPELINES],
+			app->startup_task_ns[STARTUP_TASK_PIPELINES] / 1e6,
+			startup_task_names[STARTUP_TASK_UPLOADS],
+			app->startup_task_ns[STARTUP_TASK_UPLOADS] / 1e6,
+			app->serial_startup ? "in turn" : "side by side");
+
+	const struct frame_stats *frame_stats = &app->frame_stats;
+	if (frame_stats->frames > 0) {
+		printf("frame took %.3fms on average, %.3fms at most, %.3fms of it "
+				"waiting on fences (%u frames in flight)\n",
+				frame_stats->frame_ns / 1e6 / frame_stats->frames,
+				frame_stats->max_frame_ns / 1e6,
+				frame_stats->wait_ns / 1e6 / frame_stats->frames, app->nframes);
+		printf("recorded %" PRIu64 " command buffers for %" PRIu64 " frames\n",
+				frame_stats->cmd_records, frame_stats->frames);
+	}
+	if (frame_stats->swapchain_recreations > 0) {
+		printf("recreated the swapchain %" PRIu64 " times\n",
+				frame_stats->swapchain_recreations);
+	}
+
+	const struct pacer_stats *pacer_stats = &app->pacer.stats;
+	if (pacer_stats->presents > 0) {
+		printf("%s pacing, %s present: latency %.3fms on average, "
+				"%.3fms at most (%s)\n",
+				app->pacer.mode == PACER_MODE_DISPLAY ? "display" : "content",
+				present_mode_name(app->swapchain.present_mode),
+				pacer_stats->latency_ns / 1e6 / pacer_stats->presents,
+				pacer_stats->max_latency_ns / 1e6,
+				vk->present_wait ? "until displayed" : "until queued");
+	}
+	if (pacer_stats->intervals > 0) {
+		printf("presented every %.3fms on average, %.3fms jitter, "
+				"%.3fms at most, %.3fms refresh, %" PRIu64 " unobserved\n",
+				pacer_stats->interval_sum_ns / 1e6 / pacer_stats->intervals,
+				pacer_jitter_ns(pacer_stats) / 1e6,
+				pacer_stats->max_interval_ns / 1e6,
+				app->pacer.refresh_ns / 1e6, pacer_stats->dropped);
+	}
+
+	printf("shown %" PRIu64 " frames, %" PRIu64 " uploads, %" PRIu64 " late\n",
+			app->playback.frames_shown, app->playback.uploads,
+			app->playback.late_uploads);
+
+	const struct image_upload_stats *upload_stats = &app->uploader.stats;
+	if (upload_stats->count > 0) {
+		printf("upload took %.3fms on average, %.3fms at most "
+				"(%u copy workers)\n",
+				upload_stats->total_ns / 1e6 / upload_stats->count,
+				upload_stats->max_ns / 1e6, app->uploader.workers.nworkers);
+		printf("%" PRIu64 " of %" PRIu64 " uploads copied from imported "
+				"host memory\n", upload_stats->zero_copy, upload_stats->count);
+		if (app->uploader.mode == IMAGE_UPLOAD_MODE_STAGING) {
+			printf("staging uploads waited %.3fms on average for "
+					"earlier copies\n",
+					upload_stats->wait_ns / 1e6 / upload_stats->count);
+		}
+	}
+
+	/* the device is idle, so every timestamp written is available */
+	gpu_timer_collect_all(&app->gpu_timer, vk);
+	gpu_timer_collect_all(&app->uploader.timer, vk);
+	gpu_timings_print(&app->gpu_timings);
+
+	const struct image_pool_stats *pool_stats = &app->image_pool.stats;
+	printf("image pool: %" PRIu64 " reused, %" PRIu64 " created, "
+			"%" PRIu64 " evicted\n", pool_stats->hits, pool_stats->misses,
+			pool_stats->evictions);
+
+	struct readahead_stats read_stats;
+	readahead_get_stats(&app->playback.readahead, &read_stats);
+	printf("read-ahead faulted in %" PRIu64 " frames, %" PRIu64 " stalls "
+			"(%.3fms in total, %.3fms at most)\n",
+			read_stats.frames_faulted, read_stats.stalls,
+			read_stats.stall_ns / 1e6, read_stats.max_stall_ns / 1e6);
+
+	if (app->report_path != NULL) {
+		app_write_report(app, frames_rendered, elapsed);
+	}
+}
+
 void
 app_run(struct app *app) {
 	struct window *window = app->window;
@@ -701,34 +2893,146 @@ app_run(struct app *app) {
 
 	VkResult res = VK_SUCCESS;
 
+	app->playback.start_ns = now_ns();
+
+	struct timespec cpu_start;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_start);
+
+	/* only draw on damage, resizes and when the next frame of the sequence is due */
+	uint64_t frames_rendered = 0;
 	while (!window->close_requested) {
-		window_poll_event(window);
+		bool frame_changed = playback_frame_changed(&app->playback);
+		if (!window->damaged && !window->resized && !frame_changed) {
+			int timeout_ms = playback_timeout_ms(&app->playback, &app->pacer);
+			/* nothing to do until then, so watch the last presents land */
+			if (vk->present_wait && timeout_ms != 0
+					&& pacer_oldest_pending(&app->pacer) != 0) {
+				uint64_t timeout_ns = PRESENT_WAIT_TIMEOUT_NS;
+				if (timeout_ms > 0 && timeout_ms * UINT64_C(1000000) < timeout_ns) {
+					timeout_ns = timeout_ms * UINT64_C(1000000);
+				}
+				collect_presents(app, timeout_ns);
+				timeout_ms = playback_timeout_ms(&app->playback, &app->pacer);
+			}
+			window_wait_event(window, timeout_ms);
+			continue;
+		}
+
+		uint64_t input_ns = frame_changed
+			? playback_due_ns(&app->playback, playback_target_frame(&app->playback))
+			: now_ns();
 
-		/* recreate swapchain on resize */
+		/*
+		 * every configure since the last frame was read off the connection
+		 * by now, so a resize recreates the swapchain once at the final size
+		 */
 		if (window->resized) {
-			res = create_swapchain(vk, app->surface, app->render_pass, &app->swapchain);
+			res = recreate_swapchain(app);
 			assert(res == VK_SUCCESS);
 			window->resized = false;
 		}
 
-		app_render(app);
+		window->damaged = false;
+		app_render(app, input_ns);
+		frames_rendered++;
+
+		window_poll_event(window);
 	}
 
 	vkDeviceWaitIdle(vk->device);
+
+	app_print_stats(app, frames_rendered, &cpu_start);
+}
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void
+handle_interrupt(int signal) {
+	(void) signal;
+	interrupted = 1;
+}
+
+/* renders every frame of the sequence in turn, as fast as the gpu allows */
+void
+app_run_headless(struct app *app, uint64_t frames) {
+	struct sigaction action = {
+		.sa_handler = handle_interrupt,
+	};
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	app->playback.start_ns = now_ns();
+
+	struct timespec cpu_start;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_start);
+
+	uint64_t frames_rendered = 0;
+	while (!interrupted && (frames == 0 || frames_rendered < frames)) {
+		app_render(app, now_ns());
+		frames_rendered++;
+	}
+
+	vkDeviceWaitIdle(app->vk->device);
+
+	app_print_stats(app, frames_rendered, &cpu_start);
+}
+
+/* y4m headers override the geometry given on the command line */
+static void
+open_sequence(struct app_params *params, struct sequence *sequence) {
+	/* one frame more than there are slots, so every frame is uploaded */
+	int ret = params->synthetic
+		? sequence_generate(sequence, params->width, params->height,
+				params->format, params->nslots + 1)
+		: sequence_open(sequence, params->image_path,
+				params->width, params->height, params->format);
+	if (ret == -1) {
+		exit(EXIT_FAILURE);
+	}
+
+	params->width = sequence->width;
+	params->height = sequence->height;
+	params->format = sequence->format;
+	/* a deeper window would only wrap around onto frames it already holds */
+	if (params->readahead_depth > sequence->frame_count) {
+		params->readahead_depth = sequence->frame_count;
+	}
+	if (params->fps == 0.0) {
+		params->fps = sequence->fps > 0.0 ? sequence->fps : 30.0;
+	}
 }
 
 int main(int argc, char *argv[]) {
 	struct app app = { 0 };
+	app.launch_ns = now_ns();
 	struct app_params params;
 	parse_args(&params, argc, argv);
+	if (params.trace_path != NULL && trace_open(params.trace_path) == -1) {
+		exit(EXIT_FAILURE);
+	}
+	open_sequence(&params, &app.playback.sequence);
 
 	struct vulkan_ctx_features features = {
+		.headless = params.headless,
 		.enable_ycbcr_conversion = true,
+		.enable_timeline_semaphore = true,
+		.enable_external_memory_host = params.host_import,
+		.enable_present_wait = !params.headless,
+		/* only needed to put gpu timestamps on the trace's timeline */
+		.enable_calibrated_timestamps = params.trace_path != NULL,
+		.enable_descriptor_indexing = params.ntiles > 1,
+		.enable_pipeline_cache = true,
+		.cold_pipeline_cache = params.cold_cache,
 	};
 	struct vulkan_ctx *vk = vulkan_ctx_create(&features);
 	validate_args(&params, vk);
 
 	app_init(&app, &params, vk);
-	app_run(&app);
+	if (params.headless) {
+		app_run_headless(&app, params.headless_frames);
+	} else {
+		app_run(&app);
+	}
 	app_finish(&app);
+	trace_close();
 }
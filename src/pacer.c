@@ -0,0 +1,118 @@
+#include <math.h>
+#include <string.h>
+
+#include "pacer.h"
+
+/* the main loop wakes with millisecond granularity */
+#define PACER_SLACK_NS UINT64_C(1000000)
+
+static uint64_t
+moving_average(uint64_t average, uint64_t sample) {
+	return average == 0 ? sample : (average * 7 + sample) / 8;
+}
+
+void
+pacer_init(struct pacer *ini, enum pacer_mode mode) {
+	memset(ini, 0, sizeof(struct pacer));
+	ini->mode = mode;
+}
+
+uint64_t
+pacer_wake_time(struct pacer *pacer, uint64_t due_ns) {
+	uint64_t deadline = due_ns;
+	if (pacer->mode == PACER_MODE_DISPLAY && pacer->refresh_ns > 0
+			&& pacer->last_present_ns > 0 && due_ns > pacer->last_present_ns) {
+		/* refreshes follow the last present in steps of the refresh period */
+		uint64_t refreshes = (due_ns - pacer->last_present_ns
+				+ pacer->refresh_ns - 1) / pacer->refresh_ns;
+		deadline = pacer->last_present_ns + refreshes * pacer->refresh_ns;
+	}
+
+	uint64_t cost = pacer->frame_cost_ns + PACER_SLACK_NS;
+	uint64_t wake = deadline > cost ? deadline - cost : 0;
+	pacer->lead_ns = due_ns > wake ? due_ns - wake : 0;
+	return wake;
+}
+
+void
+pacer_frame_queued(struct pacer *pacer, uint64_t id, uint64_t input_ns,
+		uint64_t begin_ns, uint64_t end_ns) {
+	pacer->frame_cost_ns = moving_average(pacer->frame_cost_ns, end_ns - begin_ns);
+
+	if (pacer->pending_count == PACER_MAX_PENDING) {
+		pacer->pending_head = (pacer->pending_head + 1) % PACER_MAX_PENDING;
+		pacer->pending_count--;
+		pacer->stats.dropped++;
+	}
+
+	uint32_t tail = (pacer->pending_head + pacer->pending_count) % PACER_MAX_PENDING;
+	pacer->pending[tail] = (struct pacer_pending) {
+		.id = id,
+		.input_ns = input_ns,
+	};
+	pacer->pending_count++;
+}
+
+uint64_t
+pacer_oldest_pending(const struct pacer *pacer) {
+	if (pacer->pending_count == 0) {
+		return 0;
+	}
+	return pacer->pending[pacer->pending_head].id;
+}
+
+void
+pacer_frame_presented(struct pacer *pacer, uint64_t present_ns) {
+	if (pacer->pending_count == 0) {
+		return;
+	}
+	struct pacer_pending *pending = &pacer->pending[pacer->pending_head];
+	pacer->pending_head = (pacer->pending_head + 1) % PACER_MAX_PENDING;
+	pacer->pending_count--;
+
+	struct pacer_stats *stats = &pacer->stats;
+	/* frames started ahead of time can be shown before they are due */
+	uint64_t latency = present_ns > pending->input_ns
+		? present_ns - pending->input_ns : 0;
+	stats->presents++;
+	stats->latency_ns += latency;
+	if (latency > stats->max_latency_ns) {
+		stats->max_latency_ns = latency;
+	}
+
+	if (pacer->last_present_ns > 0 && present_ns > pacer->last_present_ns) {
+		uint64_t interval = present_ns - pacer->last_present_ns;
+		stats->intervals++;
+		stats->interval_sum_ns += interval;
+		stats->interval_sq_sum_ns += (double) interval * interval;
+		if (interval > stats->max_interval_ns) {
+			stats->max_interval_ns = interval;
+		}
+
+		/*
+		 * presents land on refreshes, so the shortest intervals are the
+		 * refresh period. longer ones are frames that skipped refreshes.
+		 */
+		if (pacer->refresh_ns == 0 || interval < pacer->refresh_ns * 3 / 2) {
+			pacer->refresh_ns = moving_average(pacer->refresh_ns, interval);
+		}
+	}
+	pacer->last_present_ns = present_ns;
+}
+
+void
+pacer_drop_pending(struct pacer *pacer) {
+	pacer->stats.dropped += pacer->pending_count;
+	pacer->pending_head = 0;
+	pacer->pending_count = 0;
+}
+
+double
+pacer_jitter_ns(const struct pacer_stats *stats) {
+	if (stats->intervals == 0) {
+		return 0.0;
+	}
+	double mean = stats->interval_sum_ns / stats->intervals;
+	double variance = stats->interval_sq_sum_ns / stats->intervals - mean * mean;
+	return variance > 0.0 ? sqrt(variance) : 0.0;
+}
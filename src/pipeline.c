@@ -1,48 +1,24 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "pipeline.h"
+#include "convert.comp.h"
+#include "scale.frag.h"
 #include "shader.frag.h"
 #include "shader.vert.h"
+#include "wall.frag.h"
+#include "wall.vert.h"
 
-VkResult
-graphics_pipeline_init(struct graphics_pipeline *ini, struct vulkan_ctx *vk,
-		VkDescriptorSetLayout descriptor_set_layout, VkRenderPass render_pass) {
-	VkResult res;
-
-	VkPipelineLayout pipeline_layout;
-	VkPipelineLayoutCreateInfo pipeline_layout_create = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-		.setLayoutCount = 1,
-		.pSetLayouts = &descriptor_set_layout,
-	};
-	res = vkCreatePipelineLayout(vk->device, &pipeline_layout_create,
-			NULL, &pipeline_layout);
-	if (res != VK_SUCCESS) {
-		fprintf(stderr, "graphics_pipeline_init - vkCreatePipelineLayout failed\n");
-		return res;
-	}
-
-	VkShaderModule vert_shader;
-	res = vulkan_ctx_create_shader_module(vk, &vert_shader,
-			sizeof(shader_vert_data), (const void *) shader_vert_data);
-	if (res != VK_SUCCESS) {
-		fprintf(stderr, "graphics_pipeline_init - failed to create vert_shader\n");
-		return res;
-	}
-
-	VkShaderModule frag_shader;
-	res = vulkan_ctx_create_shader_module(vk, &frag_shader,
-			sizeof(shader_frag_data), (const void *) shader_frag_data);
-	if (res != VK_SUCCESS) {
-		fprintf(stderr, "graphics_pipeline_init - failed to create frag_shader\n");
-		return res;
-	}
-
+/* the pipeline drawing a quad over the viewport, shared by every fragment pass */
+static VkResult
+create_quad_pipeline(struct vulkan_ctx *vk, VkPipelineLayout pipeline_layout,
+		VkRenderPass render_pass, VkShaderModule vert_shader,
+		VkShaderModule frag_shader, const VkSpecializationInfo *frag_specialization,
+		VkPipeline *pipeline) {
 	/* viewport and scissor don't matter because they will be dynamically set */
 	VkViewport viewport = { 0 };
 	VkRect2D scissor = { 0 };
 
-	VkPipeline pipeline;
 	VkPipelineShaderStageCreateInfo vertex_stage_create = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 		.stage = VK_SHADER_STAGE_VERTEX_BIT,
@@ -54,7 +30,9 @@ graphics_pipeline_init(struct graphics_pipeline *ini, struct vulkan_ctx *vk,
 		.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
 		.module = frag_shader,
 		.pName = "main",
+		.pSpecializationInfo = frag_specialization,
 	};
+
 	VkGraphicsPipelineCreateInfo create_info = {
 		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
 		.stageCount = 2,
@@ -113,8 +91,47 @@ graphics_pipeline_init(struct graphics_pipeline *ini, struct vulkan_ctx *vk,
 		.renderPass = render_pass,
 		.subpass = 0,
 	};
-	res = vkCreateGraphicsPipelines(vk->device, VK_NULL_HANDLE, 1,
-			&create_info, NULL, &pipeline);
+	return vkCreateGraphicsPipelines(vk->device, vk->pipeline_cache, 1,
+			&create_info, NULL, pipeline);
+}
+
+VkResult
+graphics_pipeline_init(struct graphics_pipeline *ini, struct vulkan_ctx *vk,
+		VkDescriptorSetLayout descriptor_set_layout, VkRenderPass render_pass) {
+	VkResult res;
+
+	VkPipelineLayout pipeline_layout;
+	VkPipelineLayoutCreateInfo pipeline_layout_create = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &descriptor_set_layout,
+	};
+	res = vkCreatePipelineLayout(vk->device, &pipeline_layout_create,
+			NULL, &pipeline_layout);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "graphics_pipeline_init - vkCreatePipelineLayout failed\n");
+		return res;
+	}
+
+	VkShaderModule vert_shader;
+	res = vulkan_ctx_create_shader_module(vk, &vert_shader,
+			sizeof(shader_vert_data), (const void *) shader_vert_data);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "graphics_pipeline_init - failed to create vert_shader\n");
+		return res;
+	}
+
+	VkShaderModule frag_shader;
+	res = vulkan_ctx_create_shader_module(vk, &frag_shader,
+			sizeof(shader_frag_data), (const void *) shader_frag_data);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "graphics_pipeline_init - failed to create frag_shader\n");
+		return res;
+	}
+
+	VkPipeline pipeline;
+	res = create_quad_pipeline(vk, pipeline_layout, render_pass,
+			vert_shader, frag_shader, NULL, &pipeline);
 	if (res != VK_SUCCESS) {
 		fprintf(stderr, "graphics_pipeline_init - "
 				"failed to create graphics pipeline\n");
@@ -136,3 +153,438 @@ graphics_pipeline_finish(struct graphics_pipeline *pipeline,
 	vkDestroyShaderModule(vk->device, pipeline->frag_shader, NULL);
 	vkDestroyShaderModule(vk->device, pipeline->vert_shader, NULL);
 }
+
+/* luma and chroma weights of red and blue, green gets the rest */
+static void
+color_model_weights(enum image_color_model model, float *kr, float *kb) {
+	switch (model) {
+		case IMAGE_COLOR_MODEL_BT601:
+			*kr = 0.299f;
+			*kb = 0.114f;
+			return;
+		case IMAGE_COLOR_MODEL_BT709:
+			*kr = 0.2126f;
+			*kb = 0.0722f;
+			return;
+		case IMAGE_COLOR_MODEL_BT2020:
+			*kr = 0.2627f;
+			*kb = 0.0593f;
+			return;
+	}
+}
+
+static void
+compute_constants(struct convert_constants *constants,
+		enum image_color_model model, enum image_color_range range) {
+	float kr = 0.0f, kb = 0.0f;
+	color_model_weights(model, &kr, &kb);
+	float kg = 1.0f - kr - kb;
+
+	/* y = y_scale * code + y_offset, likewise for chroma centered on 0 */
+	float y_scale = 1.0f, y_offset = 0.0f;
+	float c_scale = 1.0f, c_offset = -128.0f / 255.0f;
+	if (range == IMAGE_COLOR_RANGE_LIMITED) {
+		y_scale = 255.0f / 219.0f;
+		y_offset = -16.0f / 219.0f;
+		c_scale = 255.0f / 224.0f;
+		c_offset = -128.0f / 224.0f;
+	}
+
+	float cr_r = 2.0f * (1.0f - kr);
+	float cb_g = -2.0f * kb * (1.0f - kb) / kg;
+	float cr_g = -2.0f * kr * (1.0f - kr) / kg;
+	float cb_b = 2.0f * (1.0f - kb);
+
+	*constants = (struct convert_constants) {
+		.rows = {
+			{ y_scale, 0.0f, cr_r * c_scale, y_offset + cr_r * c_offset },
+			{ y_scale, cb_g * c_scale, cr_g * c_scale,
+				y_offset + (cb_g + cr_g) * c_offset },
+			{ y_scale, cb_b * c_scale, 0.0f, y_offset + cb_b * c_offset },
+		},
+	};
+}
+
+VkResult
+convert_pipeline_init(struct convert_pipeline *ini, struct vulkan_ctx *vk,
+		VkSampler plane_sampler, enum image_format format,
+		enum image_color_model model, enum image_color_range range) {
+	VkResult res;
+
+	VkSampler samplers[3] = { plane_sampler, plane_sampler, plane_sampler };
+	VkDescriptorSetLayoutBinding bindings[4];
+	for (uint32_t plane = 0; plane < 3; plane++) {
+		bindings[plane] = (VkDescriptorSetLayoutBinding) {
+			.binding = plane,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.pImmutableSamplers = &samplers[plane],
+		};
+	}
+	bindings[3] = (VkDescriptorSetLayoutBinding) {
+		.binding = 3,
+		.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		.descriptorCount = 1,
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+	};
+	VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = 4,
+		.pBindings = bindings,
+	};
+	VkDescriptorSetLayout descriptor_set_layout;
+	res = vkCreateDescriptorSetLayout(vk->device, &descriptor_set_layout_create,
+			NULL, &descriptor_set_layout);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "convert_pipeline_init - "
+				"vkCreateDescriptorSetLayout failed\n");
+		return res;
+	}
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &descriptor_set_layout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &(VkPushConstantRange) {
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0,
+			.size = sizeof(struct convert_constants),
+		},
+	};
+	VkPipelineLayout pipeline_layout;
+	res = vkCreatePipelineLayout(vk->device, &pipeline_layout_create,
+			NULL, &pipeline_layout);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "convert_pipeline_init - vkCreatePipelineLayout failed\n");
+		vkDestroyDescriptorSetLayout(vk->device, descriptor_set_layout, NULL);
+		return res;
+	}
+
+	VkShaderModule shader;
+	res = vulkan_ctx_create_shader_module(vk, &shader,
+			sizeof(convert_comp_data), (const void *) convert_comp_data);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "convert_pipeline_init - failed to create shader\n");
+		vkDestroyPipelineLayout(vk->device, pipeline_layout, NULL);
+		vkDestroyDescriptorSetLayout(vk->device, descriptor_set_layout, NULL);
+		return res;
+	}
+
+	/* nv12 carries both chroma channels in its second plane */
+	uint32_t plane_count = image_format_plane_count(format);
+	VkComputePipelineCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.stage = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = shader,
+			.pName = "main",
+			.pSpecializationInfo = &(VkSpecializationInfo) {
+				.mapEntryCount = 1,
+				.pMapEntries = &(VkSpecializationMapEntry) {
+					.constantID = 0,
+					.offset = 0,
+					.size = sizeof(uint32_t),
+				},
+				.dataSize = sizeof(uint32_t),
+				.pData = &plane_count,
+			},
+		},
+		.layout = pipeline_layout,
+	};
+	VkPipeline pipeline;
+	res = vkCreateComputePipelines(vk->device, vk->pipeline_cache, 1,
+			&create_info, NULL, &pipeline);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "convert_pipeline_init - "
+				"failed to create compute pipeline\n");
+		vkDestroyShaderModule(vk->device, shader, NULL);
+		vkDestroyPipelineLayout(vk->device, pipeline_layout, NULL);
+		vkDestroyDescriptorSetLayout(vk->device, descriptor_set_layout, NULL);
+		return res;
+	}
+
+	ini->shader = shader;
+	ini->descriptor_set_layout = descriptor_set_layout;
+	ini->pipeline_layout = pipeline_layout;
+	ini->pipeline = pipeline;
+	compute_constants(&ini->constants, model, range);
+	return VK_SUCCESS;
+}
+
+void
+convert_pipeline_finish(struct convert_pipeline *pipeline,
+		struct vulkan_ctx *vk) {
+	vkDestroyPipeline(vk->device, pipeline->pipeline, NULL);
+	vkDestroyPipelineLayout(vk->device, pipeline->pipeline_layout, NULL);
+	vkDestroyDescriptorSetLayout(vk->device, pipeline->descriptor_set_layout, NULL);
+	vkDestroyShaderModule(vk->device, pipeline->shader, NULL);
+}
+
+void
+convert_pipeline_dispatch(struct convert_pipeline *pipeline,
+		VkCommandBuffer cmd, VkDescriptorSet descriptor_set,
+		uint32_t width, uint32_t height) {
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->pipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+			pipeline->pipeline_layout, 0, 1, &descriptor_set, 0, NULL);
+	vkCmdPushConstants(cmd, pipeline->pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT,
+			0, sizeof(struct convert_constants), &pipeline->constants);
+	/* the shader runs in groups of 16x16 texels */
+	vkCmdDispatch(cmd, (width + 15) / 16, (height + 15) / 16, 1);
+}
+
+bool
+scale_filter_separable(enum scale_filter filter) {
+	return filter == SCALE_FILTER_BICUBIC || filter == SCALE_FILTER_LANCZOS;
+}
+
+VkResult
+scale_pipeline_init(struct scale_pipeline *ini, struct vulkan_ctx *vk,
+		enum scale_filter filter, VkDescriptorSetLayout source_set_layout,
+		VkRenderPass intermediate_render_pass, VkRenderPass render_pass) {
+	VkResult res;
+
+	memset(ini, 0, sizeof(struct scale_pipeline));
+
+	/* taps are fetched at texel centers, the shader does the weighting */
+	VkSamplerCreateInfo sampler_create = {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_NEAREST,
+		.minFilter = VK_FILTER_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.minLod = 0.0f,
+		.maxLod = 0.0f,
+		.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK,
+	};
+	res = vkCreateSampler(vk->device, &sampler_create, NULL, &ini->sampler);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "scale_pipeline_init - vkCreateSampler failed\n");
+		goto fail;
+	}
+
+	VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = 1,
+		.pBindings = &(VkDescriptorSetLayoutBinding) {
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.pImmutableSamplers = &ini->sampler,
+		},
+	};
+	res = vkCreateDescriptorSetLayout(vk->device, &descriptor_set_layout_create,
+			NULL, &ini->descriptor_set_layout);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "scale_pipeline_init - "
+				"vkCreateDescriptorSetLayout failed\n");
+		goto fail;
+	}
+
+	res = vulkan_ctx_create_shader_module(vk, &ini->vert_shader,
+			sizeof(shader_vert_data), (const void *) shader_vert_data);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "scale_pipeline_init - failed to create vert_shader\n");
+		goto fail;
+	}
+	res = vulkan_ctx_create_shader_module(vk, &ini->frag_shader,
+			sizeof(scale_frag_data), (const void *) scale_frag_data);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "scale_pipeline_init - failed to create frag_shader\n");
+		goto fail;
+	}
+
+	/* 0 is catmull-rom, 1 is lanczos with 3 lobes */
+	uint32_t kernel = filter == SCALE_FILTER_LANCZOS ? 1 : 0;
+	VkSpecializationInfo specialization = {
+		.mapEntryCount = 1,
+		.pMapEntries = &(VkSpecializationMapEntry) {
+			.constantID = 0,
+			.offset = 0,
+			.size = sizeof(uint32_t),
+		},
+		.dataSize = sizeof(uint32_t),
+		.pData = &kernel,
+	};
+
+	VkDescriptorSetLayout set_layouts[SCALE_PASS_COUNT] = {
+		[SCALE_PASS_HORIZONTAL] = source_set_layout,
+		[SCALE_PASS_VERTICAL] = ini->descriptor_set_layout,
+	};
+	VkRenderPass render_passes[SCALE_PASS_COUNT] = {
+		[SCALE_PASS_HORIZONTAL] = intermediate_render_pass,
+		[SCALE_PASS_VERTICAL] = render_pass,
+	};
+	for (int pass = 0; pass < SCALE_PASS_COUNT; pass++) {
+		VkPipelineLayoutCreateInfo pipeline_layout_create = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1,
+			.pSetLayouts = &set_layouts[pass],
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &(VkPushConstantRange) {
+				.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+				.offset = 0,
+				.size = sizeof(struct scale_constants),
+			},
+		};
+		res = vkCreatePipelineLayout(vk->device, &pipeline_layout_create,
+				NULL, &ini->pipeline_layouts[pass]);
+		if (res != VK_SUCCESS) {
+			fprintf(stderr, "scale_pipeline_init - vkCreatePipelineLayout failed\n");
+			goto fail;
+		}
+
+		res = create_quad_pipeline(vk, ini->pipeline_layouts[pass],
+				render_passes[pass], ini->vert_shader, ini->frag_shader,
+				&specialization, &ini->pipelines[pass]);
+		if (res != VK_SUCCESS) {
+			fprintf(stderr, "scale_pipeline_init - "
+					"failed to create graphics pipeline\n");
+			goto fail;
+		}
+	}
+	return VK_SUCCESS;
+
+fail:
+	scale_pipeline_finish(ini, vk);
+	return res;
+}
+
+void
+scale_pipeline_finish(struct scale_pipeline *pipeline, struct vulkan_ctx *vk) {
+	for (int pass = 0; pass < SCALE_PASS_COUNT; pass++) {
+		vkDestroyPipeline(vk->device, pipeline->pipelines[pass], NULL);
+		vkDestroyPipelineLayout(vk->device, pipeline->pipeline_layouts[pass], NULL);
+	}
+	vkDestroyShaderModule(vk->device, pipeline->frag_shader, NULL);
+	vkDestroyShaderModule(vk->device, pipeline->vert_shader, NULL);
+	vkDestroyDescriptorSetLayout(vk->device, pipeline->descriptor_set_layout, NULL);
+	vkDestroySampler(vk->device, pipeline->sampler, NULL);
+	memset(pipeline, 0, sizeof(struct scale_pipeline));
+}
+
+void
+scale_pipeline_draw(struct scale_pipeline *pipeline, VkCommandBuffer cmd,
+		enum scale_pass pass, VkDescriptorSet descriptor_set,
+		uint32_t src_size, uint32_t dst_size) {
+	float ratio = (float) src_size / dst_size;
+	struct scale_constants constants = {
+		.axis = {
+			pass == SCALE_PASS_HORIZONTAL ? 1.0f : 0.0f,
+			pass == SCALE_PASS_VERTICAL ? 1.0f : 0.0f,
+		},
+		/* magnifying keeps the kernel at its width in source texels */
+		.ratio = ratio < 1.0f ? 1.0f
+			: ratio > SCALE_MAX_RATIO ? SCALE_MAX_RATIO : ratio,
+	};
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipelines[pass]);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipeline->pipeline_layouts[pass], 0, 1, &descriptor_set, 0, NULL);
+	vkCmdPushConstants(cmd, pipeline->pipeline_layouts[pass],
+			VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(struct scale_constants), &constants);
+	vkCmdDraw(cmd, 6, 1, 0, 0);
+}
+
+VkResult
+wall_pipeline_init(struct wall_pipeline *ini, struct vulkan_ctx *vk,
+		VkSampler sampler, VkRenderPass render_pass) {
+	VkResult res;
+
+	memset(ini, 0, sizeof(struct wall_pipeline));
+
+	VkSampler samplers[WALL_MAX_TILES];
+	for (uint32_t tile = 0; tile < WALL_MAX_TILES; tile++) {
+		samplers[tile] = sampler;
+	}
+	VkDescriptorSetLayoutBinding bindings[2] = {
+		{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = WALL_MAX_TILES,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.pImmutableSamplers = samplers,
+		},
+		{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		},
+	};
+	VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = 2,
+		.pBindings = bindings,
+	};
+	res = vkCreateDescriptorSetLayout(vk->device, &descriptor_set_layout_create,
+			NULL, &ini->descriptor_set_layout);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "wall_pipeline_init - "
+				"vkCreateDescriptorSetLayout failed\n");
+		goto fail;
+	}
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &ini->descriptor_set_layout,
+	};
+	res = vkCreatePipelineLayout(vk->device, &pipeline_layout_create,
+			NULL, &ini->pipeline_layout);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "wall_pipeline_init - vkCreatePipelineLayout failed\n");
+		goto fail;
+	}
+
+	res = vulkan_ctx_create_shader_module(vk, &ini->vert_shader,
+			sizeof(wall_vert_data), (const void *) wall_vert_data);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "wall_pipeline_init - failed to create vert_shader\n");
+		goto fail;
+	}
+	res = vulkan_ctx_create_shader_module(vk, &ini->frag_shader,
+			sizeof(wall_frag_data), (const void *) wall_frag_data);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "wall_pipeline_init - failed to create frag_shader\n");
+		goto fail;
+	}
+
+	res = create_quad_pipeline(vk, ini->pipeline_layout, render_pass,
+			ini->vert_shader, ini->frag_shader, NULL, &ini->pipeline);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "wall_pipeline_init - "
+				"failed to create graphics pipeline\n");
+		goto fail;
+	}
+	return VK_SUCCESS;
+
+fail:
+	wall_pipeline_finish(ini, vk);
+	return res;
+}
+
+void
+wall_pipeline_finish(struct wall_pipeline *pipeline, struct vulkan_ctx *vk) {
+	vkDestroyPipeline(vk->device, pipeline->pipeline, NULL);
+	vkDestroyPipelineLayout(vk->device, pipeline->pipeline_layout, NULL);
+	vkDestroyShaderModule(vk->device, pipeline->frag_shader, NULL);
+	vkDestroyShaderModule(vk->device, pipeline->vert_shader, NULL);
+	vkDestroyDescriptorSetLayout(vk->device, pipeline->descriptor_set_layout, NULL);
+	memset(pipeline, 0, sizeof(struct wall_pipeline));
+}
+
+void
+wall_pipeline_draw(struct wall_pipeline *pipeline, VkCommandBuffer cmd,
+		VkDescriptorSet descriptor_set, uint32_t ntiles) {
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipeline->pipeline_layout, 0, 1, &descriptor_set, 0, NULL);
+	vkCmdDraw(cmd, 6, ntiles, 0, 0);
+}
@@ -0,0 +1,170 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pipeline_cache.h"
+
+#define CACHE_DIR "vaapi-player"
+
+char *
+pipeline_cache_path(const VkPhysicalDeviceProperties *properties) {
+	const char *base = getenv("XDG_CACHE_HOME");
+	const char *suffix = "";
+	/* relative values are invalid per the spec and to be ignored */
+	if (base == NULL || base[0] != '/') {
+		base = getenv("HOME");
+		suffix = "/.cache";
+	}
+	if (base == NULL || base[0] == '\0') {
+		return NULL;
+	}
+
+	/* a file per device, so machines with several gpus don't thrash one */
+	int length = snprintf(NULL, 0, "%s%s/" CACHE_DIR "/pipelines-%04x-%04x.bin",
+			base, suffix, properties->vendorID, properties->deviceID);
+	char *path = malloc(length + 1);
+	if (path == NULL) {
+		return NULL;
+	}
+	snprintf(path, length + 1, "%s%s/" CACHE_DIR "/pipelines-%04x-%04x.bin",
+			base, suffix, properties->vendorID, properties->deviceID);
+	return path;
+}
+
+/* creates the directories leading up to the file at path */
+static int
+make_parent_dirs(const char *path) {
+	char *dir = strdup(path);
+	if (dir == NULL) {
+		return -1;
+	}
+	for (char *sep = strchr(dir + 1, '/'); sep != NULL; sep = strchr(sep + 1, '/')) {
+		*sep = '\0';
+		if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+			perror("pipeline_cache_save - mkdir");
+			free(dir);
+			return -1;
+		}
+		*sep = '/';
+	}
+	free(dir);
+	return 0;
+}
+
+/* the whole file, NULL if it can't be read */
+static void *
+read_file(const char *path, size_t *size) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		if (errno != ENOENT) {
+			perror("pipeline_cache_load - fopen");
+		}
+		return NULL;
+	}
+
+	void *data = NULL;
+	long length;
+	if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) > 0
+			&& fseek(file, 0, SEEK_SET) == 0) {
+		data = malloc(length);
+		if (data != NULL && fread(data, 1, length, file) != (size_t) length) {
+			free(data);
+			data = NULL;
+		}
+		*size = length;
+	}
+	fclose(file);
+	return data;
+}
+
+static bool
+header_matches(const void *data, size_t size,
+		const VkPhysicalDeviceProperties *properties) {
+	VkPipelineCacheHeaderVersionOne header;
+	if (size < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	return header.headerSize >= sizeof(header) && header.headerSize <= size
+		&& header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& header.vendorID == properties->vendorID
+		&& header.deviceID == properties->deviceID
+		&& memcmp(header.pipelineCacheUUID, properties->pipelineCacheUUID,
+				VK_UUID_SIZE) == 0;
+}
+
+VkResult
+pipeline_cache_load(VkDevice device, const VkPhysicalDeviceProperties *properties,
+		const char *path, VkPipelineCache *cache, bool *warm) {
+	size_t size = 0;
+	void *data = path != NULL ? read_file(path, &size) : NULL;
+	if (data != NULL && !header_matches(data, size, properties)) {
+		fprintf(stderr, "pipeline_cache_load - %s is from another device "
+				"or driver... starting with an empty cache\n", path);
+		free(data);
+		data = NULL;
+	}
+
+	VkPipelineCacheCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = data != NULL ? size : 0,
+		.pInitialData = data,
+	};
+	VkResult res = vkCreatePipelineCache(device, &create_info, NULL, cache);
+	free(data);
+	*warm = res == VK_SUCCESS && create_info.initialDataSize > 0;
+	return res;
+}
+
+int
+pipeline_cache_save(VkDevice device, VkPipelineCache cache, const char *path) {
+	size_t size = 0;
+	VkResult res = vkGetPipelineCacheData(device, cache, &size, NULL);
+	if (res != VK_SUCCESS || size == 0) {
+		return -1;
+	}
+	void *data = malloc(size);
+	if (data == NULL) {
+		return -1;
+	}
+	res = vkGetPipelineCacheData(device, cache, &size, data);
+	if (res != VK_SUCCESS) {
+		free(data);
+		return -1;
+	}
+
+	if (make_parent_dirs(path) == -1) {
+		free(data);
+		return -1;
+	}
+
+	/* unique per process, several players may exit at the same time */
+	int length = snprintf(NULL, 0, "%s.%ld", path, (long) getpid());
+	char *tmp_path = malloc(length + 1);
+	if (tmp_path == NULL) {
+		free(data);
+		return -1;
+	}
+	snprintf(tmp_path, length + 1, "%s.%ld", path, (long) getpid());
+
+	int ret = -1;
+	FILE *file = fopen(tmp_path, "wb");
+	if (file == NULL) {
+		perror("pipeline_cache_save - fopen");
+	} else {
+		bool written = fwrite(data, 1, size, file) == size;
+		if (fclose(file) == 0 && written && rename(tmp_path, path) == 0) {
+			ret = 0;
+		} else {
+			perror("pipeline_cache_save - write");
+			unlink(tmp_path);
+		}
+	}
+
+	free(tmp_path);
+	free(data);
+	return ret;
+}
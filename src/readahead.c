@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "readahead.h"
+#include "trace.h"
+
+static uint64_t
+now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/* hints the kernel about the whole frame, then touches every page of it */
+static void
+fault_in_frame(struct readahead *readahead, uint64_t frame) {
+	const struct sequence *sequence = readahead->sequence;
+	uintptr_t page_size = readahead->page_size;
+	uintptr_t begin = (uintptr_t) sequence_frame(sequence, frame % sequence->frame_count);
+	uintptr_t end = begin + sequence->frame_size;
+	begin = begin / page_size * page_size;
+
+	if (madvise((void *) begin, end - begin, MADV_WILLNEED) == -1) {
+		perror("fault_in_frame - madvise");
+	}
+
+	for (uintptr_t page = begin; page < end; page += page_size) {
+		(void) *(volatile const uint8_t *) page;
+	}
+}
+
+static void *
+readahead_main(void *data) {
+	struct readahead *readahead = data;
+
+	pthread_mutex_lock(&readahead->lock);
+	while (!readahead->stop) {
+		uint64_t frame = readahead->faulted_until;
+		if (frame >= readahead->position + readahead->depth) {
+			pthread_cond_wait(&readahead->work_cond, &readahead->lock);
+			continue;
+		}
+
+		pthread_mutex_unlock(&readahead->lock);
+		{
+			TRACE_SCOPE("fault_in_frame");
+			fault_in_frame(readahead, frame);
+		}
+		pthread_mutex_lock(&readahead->lock);
+
+		/* the consumer may have skipped past the frame in the meantime */
+		if (readahead->faulted_until == frame) {
+			readahead->faulted_until = frame + 1;
+			readahead->stats.frames_faulted++;
+			pthread_cond_broadcast(&readahead->done_cond);
+		}
+	}
+	pthread_mutex_unlock(&readahead->lock);
+	return NULL;
+}
+
+int
+readahead_init(struct readahead *ini, const struct sequence *sequence,
+		uint32_t depth) {
+	memset(ini, 0, sizeof(struct readahead));
+	ini->sequence = sequence;
+	ini->depth = depth;
+	ini->page_size = sysconf(_SC_PAGESIZE);
+	if (depth == 0) {
+		return 0;
+	}
+
+	pthread_mutex_init(&ini->lock, NULL);
+	pthread_cond_init(&ini->work_cond, NULL);
+	pthread_cond_init(&ini->done_cond, NULL);
+
+	int err = pthread_create(&ini->thread, NULL, readahead_main, ini);
+	if (err != 0) {
+		fprintf(stderr, "readahead_init - pthread_create failed: %s\n",
+				strerror(err));
+		pthread_cond_destroy(&ini->done_cond);
+		pthread_cond_destroy(&ini->work_cond);
+		pthread_mutex_destroy(&ini->lock);
+		ini->depth = 0;
+		return -1;
+	}
+	return 0;
+}
+
+void
+readahead_finish(struct readahead *readahead) {
+	if (readahead->depth == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&readahead->lock);
+	readahead->stop = true;
+	pthread_cond_broadcast(&readahead->work_cond);
+	pthread_mutex_unlock(&readahead->lock);
+	pthread_join(readahead->thread, NULL);
+
+	pthread_cond_destroy(&readahead->done_cond);
+	pthread_cond_destroy(&readahead->work_cond);
+	pthread_mutex_destroy(&readahead->lock);
+	readahead->depth = 0;
+}
+
+void
+readahead_wait(struct readahead *readahead, uint64_t frame) {
+	if (readahead->depth == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&readahead->lock);
+	if (frame > readahead->position) {
+		readahead->position = frame;
+		/* a jump ahead leaves the frames in between alone */
+		if (readahead->faulted_until < frame) {
+			readahead->faulted_until = frame;
+		}
+		pthread_cond_signal(&readahead->work_cond);
+	}
+
+	if (frame >= readahead->faulted_until) {
+		uint64_t start = now_ns();
+		while (frame >= readahead->faulted_until) {
+			pthread_cond_wait(&readahead->done_cond, &readahead->lock);
+		}
+		uint64_t end = now_ns();
+		uint64_t elapsed = end - start;
+		trace_cpu("readahead stall", start, end);
+
+		struct readahead_stats *stats = &readahead->stats;
+		stats->stalls++;
+		stats->stall_ns += elapsed;
+		if (elapsed > stats->max_stall_ns) {
+			stats->max_stall_ns = elapsed;
+		}
+	}
+	pthread_mutex_unlock(&readahead->lock);
+}
+
+void
+readahead_get_stats(struct readahead *readahead,
+		struct readahead_stats *stats) {
+	if (readahead->depth == 0) {
+		*stats = readahead->stats;
+		return;
+	}
+
+	pthread_mutex_lock(&readahead->lock);
+	*stats = readahead->stats;
+	pthread_mutex_unlock(&readahead->lock);
+}
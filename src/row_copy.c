@@ -0,0 +1,185 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "row_copy.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ROW_COPY_X86
+#include <immintrin.h>
+#endif
+
+static void
+copy_rows_scalar(void *dst, size_t dst_pitch,
+		const void *src, size_t src_pitch, size_t width, size_t rows) {
+	for (size_t row = 0; row < rows; row++) {
+		memcpy((uint8_t *) dst + row * dst_pitch,
+				(const uint8_t *) src + row * src_pitch, width);
+	}
+}
+
+#ifdef ROW_COPY_X86
+/*
+ * streaming stores need an aligned destination, so every row starts with a
+ * plain copy up to the next boundary and ends with a plain copy of the tail.
+ */
+static size_t
+bytes_to_alignment(const uint8_t *ptr, size_t alignment, size_t width) {
+	size_t head = (alignment - ((uintptr_t) ptr & (alignment - 1)))
+		& (alignment - 1);
+	return head < width ? head : width;
+}
+
+static void
+copy_rows_sse2(void *dst, size_t dst_pitch,
+		const void *src, size_t src_pitch, size_t width, size_t rows) {
+	for (size_t row = 0; row < rows; row++) {
+		uint8_t *d = (uint8_t *) dst + row * dst_pitch;
+		const uint8_t *s = (const uint8_t *) src + row * src_pitch;
+		size_t n = width;
+
+		size_t head = bytes_to_alignment(d, 16, n);
+		memcpy(d, s, head);
+		d += head;
+		s += head;
+		n -= head;
+
+		for (; n >= 64; n -= 64, d += 64, s += 64) {
+			__m128i a = _mm_loadu_si128((const __m128i *) s);
+			__m128i b = _mm_loadu_si128((const __m128i *) (s + 16));
+			__m128i c = _mm_loadu_si128((const __m128i *) (s + 32));
+			__m128i e = _mm_loadu_si128((const __m128i *) (s + 48));
+			_mm_stream_si128((__m128i *) d, a);
+			_mm_stream_si128((__m128i *) (d + 16), b);
+			_mm_stream_si128((__m128i *) (d + 32), c);
+			_mm_stream_si128((__m128i *) (d + 48), e);
+		}
+		for (; n >= 16; n -= 16, d += 16, s += 16) {
+			_mm_stream_si128((__m128i *) d,
+					_mm_loadu_si128((const __m128i *) s));
+		}
+
+		memcpy(d, s, n);
+	}
+
+	_mm_sfence();
+}
+
+__attribute__((target("avx2")))
+static void
+copy_rows_avx2(void *dst, size_t dst_pitch,
+		const void *src, size_t src_pitch, size_t width, size_t rows) {
+	for (size_t row = 0; row < rows; row++) {
+		uint8_t *d = (uint8_t *) dst + row * dst_pitch;
+		const uint8_t *s = (const uint8_t *) src + row * src_pitch;
+		size_t n = width;
+
+		size_t head = bytes_to_alignment(d, 32, n);
+		memcpy(d, s, head);
+		d += head;
+		s += head;
+		n -= head;
+
+		for (; n >= 128; n -= 128, d += 128, s += 128) {
+			__m256i a = _mm256_loadu_si256((const __m256i *) s);
+			__m256i b = _mm256_loadu_si256((const __m256i *) (s + 32));
+			__m256i c = _mm256_loadu_si256((const __m256i *) (s + 64));
+			__m256i e = _mm256_loadu_si256((const __m256i *) (s + 96));
+			_mm256_stream_si256((__m256i *) d, a);
+			_mm256_stream_si256((__m256i *) (d + 32), b);
+			_mm256_stream_si256((__m256i *) (d + 64), c);
+			_mm256_stream_si256((__m256i *) (d + 96), e);
+		}
+		for (; n >= 32; n -= 32, d += 32, s += 32) {
+			_mm256_stream_si256((__m256i *) d,
+					_mm256_loadu_si256((const __m256i *) s));
+		}
+
+		memcpy(d, s, n);
+	}
+
+	_mm_sfence();
+}
+#endif
+
+static const struct {
+	const char *name;
+	row_copy_fn fn;
+} kernels[ROW_COPY_KERNEL_COUNT] = {
+	[ROW_COPY_KERNEL_SCALAR] = { "scalar", copy_rows_scalar },
+#ifdef ROW_COPY_X86
+	[ROW_COPY_KERNEL_SSE2] = { "sse2", copy_rows_sse2 },
+	[ROW_COPY_KERNEL_AVX2] = { "avx2", copy_rows_avx2 },
+#else
+	[ROW_COPY_KERNEL_SSE2] = { "sse2", NULL },
+	[ROW_COPY_KERNEL_AVX2] = { "avx2", NULL },
+#endif
+};
+
+static bool
+kernel_supported(enum row_copy_kernel kernel) {
+	switch (kernel) {
+		case ROW_COPY_KERNEL_SCALAR:
+			return true;
+#ifdef ROW_COPY_X86
+		case ROW_COPY_KERNEL_SSE2:
+			return __builtin_cpu_supports("sse2");
+		case ROW_COPY_KERNEL_AVX2:
+			return __builtin_cpu_supports("avx2");
+#endif
+		default:
+			return false;
+	}
+}
+
+row_copy_fn
+row_copy_get_kernel(enum row_copy_kernel kernel) {
+	if (kernel >= ROW_COPY_KERNEL_COUNT || !kernel_supported(kernel)) {
+		return NULL;
+	}
+	return kernels[kernel].fn;
+}
+
+const char *
+row_copy_kernel_name(enum row_copy_kernel kernel) {
+	if (kernel >= ROW_COPY_KERNEL_COUNT) {
+		return "unknown";
+	}
+	return kernels[kernel].name;
+}
+
+static pthread_once_t best_kernel_once = PTHREAD_ONCE_INIT;
+static enum row_copy_kernel best_kernel;
+static row_copy_fn best_fn;
+
+static void
+choose_best_kernel(void) {
+	best_kernel = ROW_COPY_KERNEL_SCALAR;
+	for (int kernel = ROW_COPY_KERNEL_COUNT - 1; kernel >= 0; kernel--) {
+		if (row_copy_get_kernel(kernel) != NULL) {
+			best_kernel = kernel;
+			break;
+		}
+	}
+	best_fn = kernels[best_kernel].fn;
+}
+
+enum row_copy_kernel
+row_copy_best_kernel(void) {
+	pthread_once(&best_kernel_once, choose_best_kernel);
+	return best_kernel;
+}
+
+void
+row_copy(void *dst, size_t dst_pitch,
+		const void *src, size_t src_pitch, size_t width, size_t rows) {
+	pthread_once(&best_kernel_once, choose_best_kernel);
+
+	/* tightly packed rows are a single long row */
+	if (dst_pitch == width && src_pitch == width) {
+		width *= rows;
+		rows = 1;
+	}
+	best_fn(dst, dst_pitch, src, src_pitch, width, rows);
+}
@@ -0,0 +1,366 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sequence.h"
+
+static int
+mmap_file(const char *file, void **mapped_ptr, size_t *mapped_size) {
+	int fd = open(file, O_RDONLY);
+	if (fd == -1) {
+		perror("mmap_file - open");
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		perror("mmap_file - fstat");
+		close(fd);
+		return -1;
+	}
+
+	void *out = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (out == MAP_FAILED) {
+		perror("mmap_file - mmap");
+		return -1;
+	}
+
+	*mapped_ptr = out;
+	*mapped_size = st.st_size;
+	return 0;
+}
+
+/* past what any device takes as maxImageDimension2D */
+#define SEQUENCE_MAX_DIMENSION 16384
+
+/*
+ * frames of every container have to fit an image, and image_format_size
+ * must not wrap. subsampled chroma covers pairs of luma samples.
+ */
+static int
+check_geometry(const char *caller, uint32_t width, uint32_t height,
+		enum image_format format) {
+	if (width == 0 || height == 0 || width > SEQUENCE_MAX_DIMENSION
+			|| height > SEQUENCE_MAX_DIMENSION) {
+		fprintf(stderr, "%s - %ux%u is not between 1x1 and %dx%d\n", caller,
+				width, height, SEQUENCE_MAX_DIMENSION, SEQUENCE_MAX_DIMENSION);
+		return -1;
+	}
+	if (width % 2 != 0 || (format != IMAGE_FORMAT_422P && height % 2 != 0)) {
+		fprintf(stderr, "%s - %ux%u is odd for subsampled chroma\n", caller,
+				width, height);
+		return -1;
+	}
+	return 0;
+}
+
+#define Y4M_SIGNATURE "YUV4MPEG2 "
+#define Y4M_FRAME_TAG "FRAME"
+#define Y4M_MAX_HEADER 1024
+
+static bool
+is_y4m(const void *mapped_ptr, size_t mapped_size) {
+	return mapped_size >= strlen(Y4M_SIGNATURE)
+		&& memcmp(mapped_ptr, Y4M_SIGNATURE, strlen(Y4M_SIGNATURE)) == 0;
+}
+
+static int
+parse_y4m_chroma(const char *chroma, enum image_format *format) {
+	/* the 420 variants only differ in chroma siting */
+	if (strcmp(chroma, "420") == 0 || strcmp(chroma, "420jpeg") == 0
+			|| strcmp(chroma, "420mpeg2") == 0
+			|| strcmp(chroma, "420paldv") == 0) {
+		*format = IMAGE_FORMAT_YU12;
+	} else if (strcmp(chroma, "422") == 0) {
+		*format = IMAGE_FORMAT_422P;
+	} else {
+		fprintf(stderr, "parse_y4m_header - unsupported chroma %s\n", chroma);
+		return -1;
+	}
+	return 0;
+}
+
+/* a W or H value, 0 if it is not a number in [1, SEQUENCE_MAX_DIMENSION] */
+static uint32_t
+parse_y4m_dimension(const char *value) {
+	char *end;
+	errno = 0;
+	unsigned long dimension = strtoul(value, &end, 10);
+	if (errno != 0 || end == value || *end != '\0' || value[0] == '-'
+			|| dimension > SEQUENCE_MAX_DIMENSION) {
+		return 0;
+	}
+	return dimension;
+}
+
+/* fills the geometry of ini from the stream header, returns its length */
+static ssize_t
+parse_y4m_header(struct sequence *ini, const char *mapped_ptr,
+		size_t mapped_size) {
+	size_t search_size = mapped_size < Y4M_MAX_HEADER
+		? mapped_size : Y4M_MAX_HEADER;
+	const char *end = memchr(mapped_ptr, '\n', search_size);
+	if (end == NULL) {
+		fprintf(stderr, "parse_y4m_header - stream header is not terminated\n");
+		return -1;
+	}
+
+	/* only the header line is copied, to tokenize it */
+	char header[Y4M_MAX_HEADER];
+	size_t signature_length = strlen(Y4M_SIGNATURE);
+	size_t length = end - mapped_ptr - signature_length;
+	memcpy(header, mapped_ptr + signature_length, length);
+	header[length] = '\0';
+
+	ini->width = 0;
+	ini->height = 0;
+	ini->fps = 0.0;
+	ini->format = IMAGE_FORMAT_YU12;
+
+	char *saveptr;
+	for (char *param = strtok_r(header, " ", &saveptr); param != NULL;
+			param = strtok_r(NULL, " ", &saveptr)) {
+		switch (param[0]) {
+			case 'W':
+				ini->width = parse_y4m_dimension(param + 1);
+				if (ini->width == 0) {
+					fprintf(stderr, "parse_y4m_header - invalid width %s\n",
+							param + 1);
+					return -1;
+				}
+				break;
+			case 'H':
+				ini->height = parse_y4m_dimension(param + 1);
+				if (ini->height == 0) {
+					fprintf(stderr, "parse_y4m_header - invalid height %s\n",
+							param + 1);
+					return -1;
+				}
+				break;
+			case 'F': {
+				unsigned long num, den;
+				if (sscanf(param + 1, "%lu:%lu", &num, &den) == 2 && den != 0) {
+					ini->fps = (double) num / den;
+				}
+				break;
+			}
+			case 'C':
+				if (parse_y4m_chroma(param + 1, &ini->format) == -1) {
+					return -1;
+				}
+				break;
+			default:
+				/* interlacing, aspect ratio and extensions don't matter */
+				break;
+		}
+	}
+
+	if (ini->width == 0 || ini->height == 0) {
+		fprintf(stderr, "parse_y4m_header - missing frame size\n");
+		return -1;
+	}
+	if (check_geometry("parse_y4m_header", ini->width, ini->height,
+				ini->format) == -1) {
+		return -1;
+	}
+	return end - mapped_ptr + 1;
+}
+
+/* records where every complete frame payload starts, the file is not copied */
+static int
+index_y4m_frames(struct sequence *ini, size_t offset) {
+	const char *mapped_ptr = ini->mapped_ptr;
+	size_t tag_length = strlen(Y4M_FRAME_TAG);
+
+	/* every frame has at least its tag and a newline in front */
+	size_t max_frames = (ini->mapped_size - offset)
+		/ (ini->frame_size + tag_length + 1) + 1;
+	size_t *frame_offsets = malloc(max_frames * sizeof(size_t));
+	uint32_t frame_count = 0;
+
+	while (offset + tag_length <= ini->mapped_size
+			&& memcmp(mapped_ptr + offset, Y4M_FRAME_TAG, tag_length) == 0) {
+		const char *end = memchr(mapped_ptr + offset, '\n',
+				ini->mapped_size - offset);
+		if (end == NULL) {
+			break;
+		}
+
+		size_t payload = end - mapped_ptr + 1;
+		if (payload + ini->frame_size > ini->mapped_size) {
+			break;
+		}
+
+		frame_offsets[frame_count++] = payload;
+		offset = payload + ini->frame_size;
+	}
+
+	if (frame_count == 0) {
+		free(frame_offsets);
+		return -1;
+	}
+
+	ini->frame_offsets = frame_offsets;
+	ini->frame_count = frame_count;
+	return 0;
+}
+
+static int
+open_y4m(struct sequence *ini, const char *file) {
+	ssize_t header_length = parse_y4m_header(ini, ini->mapped_ptr,
+			ini->mapped_size);
+	if (header_length == -1) {
+		return -1;
+	}
+
+	ini->container = SEQUENCE_CONTAINER_Y4M;
+	ini->frame_size = image_format_size(ini->format, ini->width, ini->height);
+	if (index_y4m_frames(ini, header_length) == -1) {
+		fprintf(stderr, "sequence_open - %s has no complete frame\n", file);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+open_raw(struct sequence *ini, const char *file,
+		uint32_t width, uint32_t height, enum image_format format) {
+	if (width == (uint32_t) -1 || height == (uint32_t) -1
+			|| format == (enum image_format) -1) {
+		fprintf(stderr, "sequence_open - %s is a raw file, its width, height "
+				"and format have to be given\n", file);
+		return -1;
+	}
+	if (check_geometry("sequence_open", width, height, format) == -1) {
+		return -1;
+	}
+
+	size_t frame_size = image_format_size(format, width, height);
+	if (ini->mapped_size < frame_size) {
+		fprintf(stderr, "sequence_open - %s is smaller than one frame "
+				"(%zu < %zu bytes)\n", file, ini->mapped_size, frame_size);
+		return -1;
+	}
+
+	/* a trailing partial frame is ignored */
+	ini->container = SEQUENCE_CONTAINER_RAW;
+	ini->format = format;
+	ini->width = width;
+	ini->height = height;
+	ini->fps = 0.0;
+	ini->frame_size = frame_size;
+	ini->frame_count = ini->mapped_size / frame_size;
+	ini->frame_offsets = NULL;
+	return 0;
+}
+
+int
+sequence_open(struct sequence *ini, const char *file,
+		uint32_t width, uint32_t height, enum image_format format) {
+	if (mmap_file(file, &ini->mapped_ptr, &ini->mapped_size) == -1) {
+		return -1;
+	}
+	ini->frame_offsets = NULL;
+
+	int ret = is_y4m(ini->mapped_ptr, ini->mapped_size)
+		? open_y4m(ini, file)
+		: open_raw(ini, file, width, height, format);
+	if (ret == -1) {
+		munmap(ini->mapped_ptr, ini->mapped_size);
+		ini->mapped_ptr = NULL;
+		ini->mapped_size = 0;
+		return -1;
+	}
+	return 0;
+}
+
+static void
+generate_frame(uint8_t *frame, uint32_t width, uint32_t height,
+		enum image_format format, uint32_t index) {
+	for (uint32_t plane = 0; plane < image_format_plane_count(format); plane++) {
+		uint32_t plane_width, plane_height;
+		image_format_plane_size(format, width, height,
+				&plane_width, &plane_height, plane);
+
+		/* luma scrolls diagonally, chroma drifts slowly */
+		for (uint32_t y = 0; y < plane_height; y++) {
+			uint8_t *row = frame + (size_t) y * plane_width;
+			for (uint32_t x = 0; x < plane_width; x++) {
+				row[x] = plane == 0
+					? (uint8_t) (x + y + index * 8)
+					: (uint8_t) (128 + (x >> 4) + index);
+			}
+		}
+		frame += (size_t) plane_width * plane_height;
+	}
+}
+
+int
+sequence_generate(struct sequence *ini, uint32_t width, uint32_t height,
+		enum image_format format, uint32_t frame_count) {
+	if (width == (uint32_t) -1 || height == (uint32_t) -1
+			|| format == (enum image_format) -1) {
+		fprintf(stderr, "sequence_generate - width, height and format "
+				"have to be given\n");
+		return -1;
+	}
+	if (check_geometry("sequence_generate", width, height, format) == -1) {
+		return -1;
+	}
+
+	size_t frame_size = image_format_size(format, width, height);
+	size_t mapped_size = frame_size * frame_count;
+	/* mapped rather than allocated, so sequence_close doesn't care */
+	void *mapped_ptr = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapped_ptr == MAP_FAILED) {
+		perror("sequence_generate - mmap");
+		return -1;
+	}
+
+	for (uint32_t frame = 0; frame < frame_count; frame++) {
+		generate_frame((uint8_t *) mapped_ptr + frame * frame_size,
+				width, height, format, frame);
+	}
+
+	ini->mapped_ptr = mapped_ptr;
+	ini->mapped_size = mapped_size;
+	ini->container = SEQUENCE_CONTAINER_SYNTHETIC;
+	ini->format = format;
+	ini->width = width;
+	ini->height = height;
+	ini->fps = 0.0;
+	ini->frame_size = frame_size;
+	ini->frame_count = frame_count;
+	ini->frame_offsets = NULL;
+	return 0;
+}
+
+const void *
+sequence_frame(const struct sequence *sequence, uint32_t frame) {
+	if (sequence->frame_offsets != NULL) {
+		return (const uint8_t *) sequence->mapped_ptr
+			+ sequence->frame_offsets[frame % sequence->frame_count];
+	}
+	return (const uint8_t *) sequence->mapped_ptr
+		+ (size_t) (frame % sequence->frame_count) * sequence->frame_size;
+}
+
+void
+sequence_close(struct sequence *sequence) {
+	if (munmap(sequence->mapped_ptr, sequence->mapped_size) == -1) {
+		perror("sequence_close - munmap");
+	}
+	sequence->mapped_ptr = NULL;
+	sequence->mapped_size = 0;
+	free(sequence->frame_offsets);
+	sequence->frame_offsets = NULL;
+	sequence->frame_count = 0;
+}
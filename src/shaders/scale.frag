@@ -0,0 +1,60 @@
+#version 450
+
+/* 0 is catmull-rom, 1 is lanczos with 3 lobes */
+layout(constant_id = 0) const uint kernel = 0;
+
+layout(binding = 0) uniform sampler2D tex_sampler;
+layout(location = 0) in vec2 tex_coord;
+layout(location = 0) out vec4 out_color;
+
+/* axis is (1, 0) or (0, 1), ratio is source over destination, at least 1 */
+layout(push_constant) uniform constants {
+	vec2 axis;
+	float ratio;
+};
+
+const float PI = 3.14159265359;
+
+float weight(float x) {
+	x = abs(x);
+	if (kernel == 0u) {
+		if (x < 1.0) {
+			return (1.5 * x - 2.5) * x * x + 1.0;
+		}
+		if (x < 2.0) {
+			return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+		}
+		return 0.0;
+	}
+	if (x < 1e-5) {
+		return 1.0;
+	}
+	if (x >= 3.0) {
+		return 0.0;
+	}
+	float px = PI * x;
+	return 3.0 * sin(px) * sin(px / 3.0) / (px * px);
+}
+
+void main() {
+	vec2 size = vec2(textureSize(tex_sampler, 0));
+	float extent = dot(size, axis);
+	float radius = (kernel == 0u ? 2.0 : 3.0) * ratio;
+
+	/* in texels along the axis, with texel centers on integers */
+	float center = dot(tex_coord * size, axis) - 0.5;
+	float first = floor(center - radius) + 1.0;
+	int taps = int(ceil(2.0 * radius));
+
+	vec4 sum = vec4(0.0);
+	float weights = 0.0;
+	for (int tap = 0; tap < taps; tap++) {
+		float texel = first + float(tap);
+		float w = weight((texel - center) / ratio);
+		/* the other axis stays where the fragment is, on a texel center */
+		float coord = (clamp(texel, 0.0, extent - 1.0) + 0.5) / extent;
+		sum += w * texture(tex_sampler, mix(tex_coord, vec2(coord), axis));
+		weights += w;
+	}
+	out_color = sum / weights;
+}
@@ -0,0 +1,13 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+/* WALL_MAX_TILES, entries past the tile count repeat the last tile */
+layout(binding = 0) uniform sampler2D tiles[64];
+layout(location = 0) in vec2 tex_coord;
+layout(location = 1) flat in uint tile;
+layout(location = 0) out vec4 out_color;
+
+void main() {
+	/* instances of a draw may share a subgroup, so the index isn't uniform */
+	out_color = texture(tiles[nonuniformEXT(tile)], tex_coord);
+}
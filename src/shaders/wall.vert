@@ -0,0 +1,26 @@
+#version 450
+
+/* x, y, width and height of each tile, as fractions of the viewport */
+layout(std430, binding = 1) readonly buffer tile_rects {
+	vec4 rects[];
+};
+
+vec2 corners[6] = vec2[](
+	vec2(0, 0),
+	vec2(1, 0),
+	vec2(1, 1),
+	vec2(1, 1),
+	vec2(0, 1),
+	vec2(0, 0)
+);
+
+layout(location = 0) out vec2 out_tex_coord;
+layout(location = 1) flat out uint out_tile;
+
+void main() {
+	vec4 rect = rects[gl_InstanceIndex];
+	vec2 corner = corners[gl_VertexIndex];
+	gl_Position = vec4((rect.xy + corner * rect.zw) * 2.0 - 1.0, 0.0, 1.0);
+	out_tex_coord = corner;
+	out_tile = uint(gl_InstanceIndex);
+}
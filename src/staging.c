@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "staging.h"
+
+static VkDeviceSize
+align_up(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+VkResult
+staging_ring_init(struct staging_ring *ini, struct vulkan_ctx *vk,
+		VkDeviceSize size, VkSemaphore timeline) {
+	VkResult res;
+
+	VkBuffer buffer;
+	VkBufferCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = size,
+		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 1,
+		.pQueueFamilyIndices = &vk->queue_family_index,
+	};
+	res = vkCreateBuffer(vk->device, &create_info, NULL, &buffer);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "staging_ring_init - vkCreateBuffer failed\n");
+		return res;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(vk->device, buffer, &requirements);
+	if (!(requirements.memoryTypeBits & (1 << vk->host_visible_memory_index))) {
+		fprintf(stderr, "staging_ring_init - buffer can't be host visible\n");
+		vkDestroyBuffer(vk->device, buffer, NULL);
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+	}
+
+	VkDeviceMemory memory;
+	VkMemoryAllocateInfo alloc_info = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.memoryTypeIndex = vk->host_visible_memory_index,
+		.allocationSize = requirements.size,
+	};
+	res = vkAllocateMemory(vk->device, &alloc_info, NULL, &memory);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "staging_ring_init - vkAllocateMemory failed\n");
+		vkDestroyBuffer(vk->device, buffer, NULL);
+		return res;
+	}
+
+	void *mapped_ptr;
+	res = vkBindBufferMemory(vk->device, buffer, memory, 0);
+	if (res == VK_SUCCESS) {
+		res = vkMapMemory(vk->device, memory, 0, VK_WHOLE_SIZE, 0, &mapped_ptr);
+	}
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "staging_ring_init - failed to map staging memory\n");
+		vkFreeMemory(vk->device, memory, NULL);
+		vkDestroyBuffer(vk->device, buffer, NULL);
+		return res;
+	}
+
+	ini->buffer = buffer;
+	ini->memory = memory;
+	ini->mapped_ptr = mapped_ptr;
+	ini->size = size;
+	ini->timeline = timeline;
+	ini->head = 0;
+	ini->first_region = 0;
+	ini->nregions = 0;
+	ini->wait_ns = 0;
+	return VK_SUCCESS;
+}
+
+void
+staging_ring_finish(struct staging_ring *ring, struct vulkan_ctx *vk) {
+	vkUnmapMemory(vk->device, ring->memory);
+	ring->mapped_ptr = NULL;
+	vkDestroyBuffer(vk->device, ring->buffer, NULL);
+	ring->buffer = VK_NULL_HANDLE;
+	vkFreeMemory(vk->device, ring->memory, NULL);
+	ring->memory = VK_NULL_HANDLE;
+}
+
+static struct staging_ring_region *
+oldest_region(struct staging_ring *ring) {
+	return &ring->regions[ring->first_region];
+}
+
+static void
+retire_regions(struct staging_ring *ring, uint64_t completed) {
+	while (ring->nregions > 0 && oldest_region(ring)->value <= completed) {
+		ring->first_region = (ring->first_region + 1) % STAGING_RING_MAX_REGIONS;
+		ring->nregions--;
+	}
+}
+
+/* blocks until the oldest region has been retired */
+static VkResult
+wait_oldest_region(struct staging_ring *ring, struct vulkan_ctx *vk) {
+	uint64_t value = oldest_region(ring)->value;
+	if (value == STAGING_RING_PENDING) {
+		/* nothing would ever signal it, the ring is too small */
+		return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	}
+
+	VkSemaphoreWaitInfo wait_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &ring->timeline,
+		.pValues = &value,
+	};
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	VkResult res = vkWaitSemaphores(vk->device, &wait_info, UINT64_MAX);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ring->wait_ns += (end.tv_sec - start.tv_sec) * UINT64_C(1000000000)
+		+ end.tv_nsec - start.tv_nsec;
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	retire_regions(ring, value);
+	return VK_SUCCESS;
+}
+
+static bool
+try_alloc(struct staging_ring *ring, VkDeviceSize size, VkDeviceSize alignment,
+		VkDeviceSize *offset) {
+	if (ring->nregions == STAGING_RING_MAX_REGIONS) {
+		return false;
+	}
+
+	if (ring->nregions == 0) {
+		ring->head = 0;
+	}
+
+	VkDeviceSize tail = ring->nregions > 0 ? oldest_region(ring)->begin : 0;
+	VkDeviceSize candidate = align_up(ring->head, alignment);
+	if (ring->nregions > 0 && ring->head <= tail) {
+		/* in use from tail to the end and from the start to head */
+		if (ring->head != tail && candidate + size <= tail) {
+			*offset = candidate;
+			return true;
+		}
+		return false;
+	}
+
+	if (candidate + size <= ring->size) {
+		*offset = candidate;
+		return true;
+	}
+
+	/* wrap around, the space before tail is free */
+	if (size <= tail) {
+		*offset = 0;
+		return true;
+	}
+	return false;
+}
+
+VkResult
+staging_ring_alloc(struct staging_ring *ring, struct vulkan_ctx *vk,
+		VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize *offset) {
+	if (align_up(size, alignment) > ring->size) {
+		fprintf(stderr, "staging_ring_alloc - %lu bytes don't fit "
+				"in the ring\n", (unsigned long) size);
+		return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	}
+
+	uint64_t completed;
+	VkResult res = vkGetSemaphoreCounterValue(vk->device, ring->timeline,
+			&completed);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+	retire_regions(ring, completed);
+
+	while (!try_alloc(ring, size, alignment, offset)) {
+		res = wait_oldest_region(ring, vk);
+		if (res != VK_SUCCESS) {
+			fprintf(stderr, "staging_ring_alloc - failed to retire a region\n");
+			return res;
+		}
+	}
+
+	uint32_t last = (ring->first_region + ring->nregions) % STAGING_RING_MAX_REGIONS;
+	ring->regions[last] = (struct staging_ring_region) {
+		.begin = *offset,
+		.end = *offset + size,
+		.value = STAGING_RING_PENDING,
+	};
+	ring->nregions++;
+	ring->head = *offset + size;
+	return VK_SUCCESS;
+}
+
+void
+staging_ring_submit(struct staging_ring *ring, uint64_t value) {
+	for (uint32_t i = ring->nregions; i > 0; i--) {
+		struct staging_ring_region *region =
+			&ring->regions[(ring->first_region + i - 1) % STAGING_RING_MAX_REGIONS];
+		if (region->value != STAGING_RING_PENDING) {
+			break;
+		}
+		region->value = value;
+	}
+}
@@ -0,0 +1,97 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/* no thread of the process gets an id this small, those belong to init */
+static const long gpu_track_tids[TRACE_GPU_TRACK_COUNT] = {
+	[TRACE_GPU_TRACK_RENDER] = 0,
+	[TRACE_GPU_TRACK_UPLOAD] = 1,
+};
+static const char *gpu_track_names[TRACE_GPU_TRACK_COUNT] = {
+	[TRACE_GPU_TRACK_RENDER] = "gpu render",
+	[TRACE_GPU_TRACK_UPLOAD] = "gpu upload",
+};
+
+bool trace_enabled = false;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *trace_file = NULL;
+static int trace_pid;
+
+static __thread long thread_id = 0;
+
+uint64_t
+trace_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/* names are expected to be literals that need no escaping */
+static void
+write_event(const char *name, long tid, uint64_t begin_ns, uint64_t end_ns) {
+	pthread_mutex_lock(&trace_lock);
+	if (trace_file != NULL) {
+		/* the gpu track names are written first, so every event follows a comma */
+		fprintf(trace_file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,"
+				"\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f}",
+				name, trace_pid, tid, begin_ns / 1e3, (end_ns - begin_ns) / 1e3);
+	}
+	pthread_mutex_unlock(&trace_lock);
+}
+
+int
+trace_open(const char *path) {
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		perror("trace_open - fopen");
+		return -1;
+	}
+
+	pthread_mutex_lock(&trace_lock);
+	trace_file = file;
+	trace_pid = getpid();
+	for (int track = 0; track < TRACE_GPU_TRACK_COUNT; track++) {
+		fprintf(trace_file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+				"\"tid\":%ld,\"args\":{\"name\":\"%s\"}}", track == 0 ? "[\n" : ",\n",
+				trace_pid, gpu_track_tids[track], gpu_track_names[track]);
+	}
+	pthread_mutex_unlock(&trace_lock);
+
+	trace_enabled = true;
+	return 0;
+}
+
+void
+trace_close(void) {
+	trace_enabled = false;
+
+	pthread_mutex_lock(&trace_lock);
+	if (trace_file != NULL) {
+		fprintf(trace_file, "\n]\n");
+		fclose(trace_file);
+		trace_file = NULL;
+	}
+	pthread_mutex_unlock(&trace_lock);
+}
+
+void
+trace_cpu(const char *name, uint64_t begin_ns, uint64_t end_ns) {
+	if (!trace_enabled) {
+		return;
+	}
+	if (thread_id == 0) {
+		thread_id = syscall(SYS_gettid);
+	}
+	write_event(name, thread_id, begin_ns, end_ns);
+}
+
+void
+trace_gpu(const char *name, enum trace_gpu_track track,
+		uint64_t begin_ns, uint64_t end_ns) {
+	write_event(name, gpu_track_tids[track], begin_ns, end_ns);
+}
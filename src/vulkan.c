@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "pipeline_cache.h"
 #include "vulkan.h"
 
 static uint32_t
@@ -33,7 +34,7 @@ find_memory_index(VkPhysicalDeviceMemoryProperties *memory_properties,
 }
 
 static VkResult
-create_vulkan_instance(VkInstance *instance) {
+create_vulkan_instance(VkInstance *instance, bool headless) {
     VkResult res = VK_ERROR_UNKNOWN;
 
     uint32_t layer_count = 32;
@@ -78,8 +79,10 @@ create_vulkan_instance(VkInstance *instance) {
 		VK_KHR_SURFACE_EXTENSION_NAME,
 		VK_KHR_XCB_SURFACE_EXTENSION_NAME,
 	};
-	create_info.enabledExtensionCount = 2;
-	create_info.ppEnabledExtensionNames = extensions;
+	if (!headless) {
+		create_info.enabledExtensionCount = 2;
+		create_info.ppEnabledExtensionNames = extensions;
+	}
 
     res = vkCreateInstance(&create_info, NULL, instance);
     if (res != VK_SUCCESS) {
@@ -89,6 +92,49 @@ create_vulkan_instance(VkInstance *instance) {
     return res;
 }
 
+static bool
+has_device_extension(VkPhysicalDevice device, const char *name) {
+	VkExtensionProperties properties[256];
+	uint32_t count = sizeof(properties) / sizeof(properties[0]);
+	VkResult res = vkEnumerateDeviceExtensionProperties(device, NULL,
+			&count, properties);
+	if (res != VK_SUCCESS && res != VK_INCOMPLETE) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (strcmp(properties[i].extensionName, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* whether device timestamps can be calibrated against CLOCK_MONOTONIC */
+static bool
+has_monotonic_time_domain(VkInstance instance, VkPhysicalDevice device) {
+	PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT get_time_domains =
+		(PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT) vkGetInstanceProcAddr(
+				instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+	if (get_time_domains == NULL) {
+		return false;
+	}
+
+	VkTimeDomainEXT domains[8];
+	uint32_t count = sizeof(domains) / sizeof(domains[0]);
+	VkResult res = get_time_domains(device, &count, domains);
+	if (res != VK_SUCCESS && res != VK_INCOMPLETE) {
+		return false;
+	}
+
+	bool has_device = false, has_monotonic = false;
+	for (uint32_t i = 0; i < count; i++) {
+		has_device |= domains[i] == VK_TIME_DOMAIN_DEVICE_EXT;
+		has_monotonic |= domains[i] == VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+	}
+	return has_device && has_monotonic;
+}
+
 static VkResult
 create_vulkan_device(struct vulkan_ctx *ini, struct vulkan_ctx_features *features) {
     int32_t queue_index = find_unified_queue(ini->physical_device);
@@ -105,21 +151,91 @@ create_vulkan_device(struct vulkan_ctx *ini, struct vulkan_ctx_features *feature
         .pQueuePriorities = &queue_priority,
     };
 
-	const char *extensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	const char *extensions[5];
+	uint32_t extension_count = 0;
+	bool headless = features && features->headless;
+	if (!headless) {
+		extensions[extension_count++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+	}
+	if (features && features->enable_external_memory_host
+			&& has_device_extension(ini->physical_device,
+				VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME)) {
+		extensions[extension_count++] = VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME;
+		ini->external_memory_host = true;
+	}
+
+	VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+	};
+	VkPhysicalDevicePresentIdFeaturesKHR present_id_features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+		.pNext = &present_wait_features,
+	};
+	if (!headless && features && features->enable_present_wait
+			&& has_device_extension(ini->physical_device,
+				VK_KHR_PRESENT_ID_EXTENSION_NAME)
+			&& has_device_extension(ini->physical_device,
+				VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+		VkPhysicalDeviceFeatures2 supported = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &present_id_features,
+		};
+		vkGetPhysicalDeviceFeatures2(ini->physical_device, &supported);
+		if (present_id_features.presentId && present_wait_features.presentWait) {
+			extensions[extension_count++] = VK_KHR_PRESENT_ID_EXTENSION_NAME;
+			extensions[extension_count++] = VK_KHR_PRESENT_WAIT_EXTENSION_NAME;
+			ini->present_wait = true;
+		}
+	}
+
+	if (features && features->enable_calibrated_timestamps
+			&& has_device_extension(ini->physical_device,
+				VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)
+			&& has_monotonic_time_domain(ini->instance, ini->physical_device)) {
+		extensions[extension_count++] = VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME;
+		ini->calibrated_timestamps = true;
+	}
+
     VkDeviceCreateInfo device_create_info = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
         .queueCreateInfoCount = 1,
         .pQueueCreateInfos = &queue_create_info,
-		.enabledExtensionCount = 1,
+		.enabledExtensionCount = extension_count,
 		.ppEnabledExtensionNames = extensions,
     };
 
+	if (features && (features->enable_timeline_semaphore
+				|| features->enable_descriptor_indexing)) {
+		VkPhysicalDeviceVulkan12Features supported12 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+		};
+		VkPhysicalDeviceFeatures2 supported = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &supported12,
+		};
+		vkGetPhysicalDeviceFeatures2(ini->physical_device, &supported);
+		ini->timeline_semaphore = features->enable_timeline_semaphore
+			&& supported12.timelineSemaphore;
+		ini->descriptor_indexing = features->enable_descriptor_indexing
+			&& supported12.shaderSampledImageArrayNonUniformIndexing;
+	}
+
+	VkPhysicalDeviceVulkan12Features vulkan12_features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+		.timelineSemaphore = ini->timeline_semaphore,
+		.shaderSampledImageArrayNonUniformIndexing = ini->descriptor_indexing,
+	};
 	VkPhysicalDeviceVulkan11Features vulkan11_features = {
 		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
+		.pNext = &vulkan12_features,
 		.samplerYcbcrConversion = features && features->enable_ycbcr_conversion,
 	};
 
     device_create_info.pNext = &vulkan11_features;
+	if (ini->present_wait) {
+		/* both were reported as supported above */
+		vulkan12_features.pNext = &present_id_features;
+	}
 
     VkResult res = VK_ERROR_UNKNOWN;
     res = vkCreateDevice(ini->physical_device, &device_create_info, NULL, &ini->device);
@@ -128,6 +244,47 @@ create_vulkan_device(struct vulkan_ctx *ini, struct vulkan_ctx_features *feature
     }
 
     vkGetDeviceQueue(ini->device, queue_index, 0, &ini->queue);
+
+	if (ini->external_memory_host) {
+		VkPhysicalDeviceMaintenance3Properties maintenance3_properties = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_3_PROPERTIES,
+		};
+		VkPhysicalDeviceExternalMemoryHostPropertiesEXT host_properties = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT,
+			.pNext = &maintenance3_properties,
+		};
+		VkPhysicalDeviceProperties2 properties = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+			.pNext = &host_properties,
+		};
+		vkGetPhysicalDeviceProperties2(ini->physical_device, &properties);
+		ini->min_imported_host_pointer_alignment =
+			host_properties.minImportedHostPointerAlignment;
+		ini->max_memory_allocation_size =
+			maintenance3_properties.maxMemoryAllocationSize;
+		ini->get_memory_host_pointer_properties =
+			(PFN_vkGetMemoryHostPointerPropertiesEXT) vkGetDeviceProcAddr(
+					ini->device, "vkGetMemoryHostPointerPropertiesEXT");
+		if (ini->get_memory_host_pointer_properties == NULL) {
+			ini->external_memory_host = false;
+		}
+	}
+
+	if (ini->present_wait) {
+		ini->wait_for_present = (PFN_vkWaitForPresentKHR) vkGetDeviceProcAddr(
+				ini->device, "vkWaitForPresentKHR");
+		if (ini->wait_for_present == NULL) {
+			ini->present_wait = false;
+		}
+	}
+
+	if (ini->calibrated_timestamps) {
+		ini->get_calibrated_timestamps = (PFN_vkGetCalibratedTimestampsEXT)
+			vkGetDeviceProcAddr(ini->device, "vkGetCalibratedTimestampsEXT");
+		if (ini->get_calibrated_timestamps == NULL) {
+			ini->calibrated_timestamps = false;
+		}
+	}
     return res;
 }
 
@@ -137,7 +294,7 @@ vulkan_ctx_create(struct vulkan_ctx_features *features) {
 
     struct vulkan_ctx *ini = calloc(1, sizeof(struct vulkan_ctx));
 
-    res = create_vulkan_instance(&ini->instance);
+    res = create_vulkan_instance(&ini->instance, features && features->headless);
     assert(res == VK_SUCCESS);
 
     uint32_t physical_device_count = 1;
@@ -148,9 +305,8 @@ vulkan_ctx_create(struct vulkan_ctx_features *features) {
     }
     assert(res == VK_SUCCESS);
 
-    VkPhysicalDeviceProperties physical_device_properties;
-    vkGetPhysicalDeviceProperties(ini->physical_device, &physical_device_properties);
-    printf("using physical device 0: %s\n", physical_device_properties.deviceName);
+    vkGetPhysicalDeviceProperties(ini->physical_device, &ini->physical_device_properties);
+    printf("using physical device 0: %s\n", ini->physical_device_properties.deviceName);
 
     res = create_vulkan_device(ini, features);
     assert(res == VK_SUCCESS);
@@ -161,6 +317,25 @@ vulkan_ctx_create(struct vulkan_ctx_features *features) {
 	ini->host_visible_memory_index = find_memory_index(&ini->memory_properties,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
 
+	memory_allocator_init(&ini->allocator, ini->device, &ini->memory_properties,
+			ini->physical_device_properties.limits.bufferImageGranularity);
+
+	if (features && features->enable_pipeline_cache) {
+		ini->pipeline_cache_path = pipeline_cache_path(&ini->physical_device_properties);
+		if (ini->pipeline_cache_path == NULL) {
+			fprintf(stderr, "vulkan_ctx_create - neither XDG_CACHE_HOME nor HOME "
+					"is set... not keeping pipelines between runs\n");
+		}
+		res = pipeline_cache_load(ini->device, &ini->physical_device_properties,
+				features->cold_pipeline_cache ? NULL : ini->pipeline_cache_path,
+				&ini->pipeline_cache, &ini->pipeline_cache_warm);
+		if (res != VK_SUCCESS) {
+			fprintf(stderr, "vulkan_ctx_create - vkCreatePipelineCache failed (%d)... "
+					"creating pipelines without a cache\n", res);
+			ini->pipeline_cache = VK_NULL_HANDLE;
+		}
+	}
+
     return ini;
 }
 
@@ -169,6 +344,18 @@ vulkan_ctx_destroy(struct vulkan_ctx *ctx) {
     ctx->queue = VK_NULL_HANDLE;
     ctx->physical_device = VK_NULL_HANDLE;
 
+	memory_allocator_finish(&ctx->allocator);
+
+	if (ctx->pipeline_cache != VK_NULL_HANDLE) {
+		if (ctx->pipeline_cache_path != NULL) {
+			pipeline_cache_save(ctx->device, ctx->pipeline_cache,
+					ctx->pipeline_cache_path);
+		}
+		vkDestroyPipelineCache(ctx->device, ctx->pipeline_cache, NULL);
+		ctx->pipeline_cache = VK_NULL_HANDLE;
+	}
+	free(ctx->pipeline_cache_path);
+
     vkDestroyDevice(ctx->device, NULL);
     ctx->device = VK_NULL_HANDLE;
 
@@ -201,6 +388,24 @@ vulkan_ctx_create_semaphore(struct vulkan_ctx *ctx, VkSemaphore *semaphore) {
 	return vkCreateSemaphore(ctx->device, &create_info, NULL, semaphore);
 }
 
+VkResult
+vulkan_ctx_create_timeline_semaphore(struct vulkan_ctx *ctx,
+		VkSemaphore *semaphore, uint64_t initial_value) {
+	if (!ctx->timeline_semaphore) {
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+	}
+	VkSemaphoreTypeCreateInfo type_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = initial_value,
+	};
+	VkSemaphoreCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &type_info,
+	};
+	return vkCreateSemaphore(ctx->device, &create_info, NULL, semaphore);
+}
+
 VkResult
 vulkan_ctx_create_cmd_pool(struct vulkan_ctx *ctx, VkCommandPool *cmd_pool,
 		VkCommandPoolCreateFlags flags) {
@@ -222,3 +427,86 @@ vulkan_ctx_create_shader_module(struct vulkan_ctx *ctx,
 	};
 	return vkCreateShaderModule(ctx->device, &create_info, NULL, shader_module);
 }
+
+/*
+ * wraps host memory the caller keeps alive in a buffer, without copying.
+ * host_ptr and size must be multiples of min_imported_host_pointer_alignment.
+ */
+VkResult
+vulkan_ctx_import_host_buffer(struct vulkan_ctx *ctx,
+		void *host_ptr, VkDeviceSize size, VkBufferUsageFlags usage,
+		VkBuffer *buffer, VkDeviceMemory *memory) {
+	VkResult res;
+
+	if (!ctx->external_memory_host) {
+		return VK_ERROR_EXTENSION_NOT_PRESENT;
+	}
+
+	VkDeviceSize alignment = ctx->min_imported_host_pointer_alignment;
+	if ((uintptr_t) host_ptr % alignment != 0 || size % alignment != 0) {
+		return VK_ERROR_INVALID_EXTERNAL_HANDLE;
+	}
+
+	VkMemoryHostPointerPropertiesEXT pointer_properties = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT,
+	};
+	res = ctx->get_memory_host_pointer_properties(ctx->device,
+			VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+			host_ptr, &pointer_properties);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	VkExternalMemoryBufferCreateInfo external_info = {
+		.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO,
+		.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+	};
+	VkBufferCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext = &external_info,
+		.size = size,
+		.usage = usage,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 1,
+		.pQueueFamilyIndices = &ctx->queue_family_index,
+	};
+	res = vkCreateBuffer(ctx->device, &create_info, NULL, buffer);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(ctx->device, *buffer, &requirements);
+	uint32_t memory_type_bits = requirements.memoryTypeBits
+		& pointer_properties.memoryTypeBits;
+	if (memory_type_bits == 0) {
+		vkDestroyBuffer(ctx->device, *buffer, NULL);
+		return VK_ERROR_INVALID_EXTERNAL_HANDLE;
+	}
+
+	VkImportMemoryHostPointerInfoEXT import_info = {
+		.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT,
+		.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+		.pHostPointer = host_ptr,
+	};
+	VkMemoryAllocateInfo alloc_info = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.pNext = &import_info,
+		.allocationSize = size,
+		.memoryTypeIndex = __builtin_ctz(memory_type_bits),
+	};
+	res = vkAllocateMemory(ctx->device, &alloc_info, NULL, memory);
+	if (res != VK_SUCCESS) {
+		vkDestroyBuffer(ctx->device, *buffer, NULL);
+		return res;
+	}
+
+	res = vkBindBufferMemory(ctx->device, *buffer, *memory, 0);
+	if (res != VK_SUCCESS) {
+		vkFreeMemory(ctx->device, *memory, NULL);
+		vkDestroyBuffer(ctx->device, *buffer, NULL);
+		return res;
+	}
+
+	return VK_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "wall.h"
+
+VkResult
+wall_init(struct wall *ini, struct vulkan_ctx *vk, uint32_t ntiles) {
+	VkResult res;
+
+	memset(ini, 0, sizeof(struct wall));
+	ini->ntiles = ntiles;
+	ini->columns = (uint32_t) ceil(sqrt(ntiles));
+	ini->rows = (ntiles + ini->columns - 1) / ini->columns;
+
+	VkBufferCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = ntiles * 4 * sizeof(float),
+		.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 1,
+		.pQueueFamilyIndices = &vk->queue_family_index,
+	};
+	res = vkCreateBuffer(vk->device, &create_info, NULL, &ini->rect_buffer);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "wall_init - vkCreateBuffer failed\n");
+		return res;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(vk->device, ini->rect_buffer, &requirements);
+	res = memory_allocator_alloc(&vk->allocator, &requirements,
+			vk->host_visible_memory_index, true, &ini->rect_allocation);
+	if (res != VK_SUCCESS) {
+		fprintf(stderr, "wall_init - memory_allocator_alloc failed\n");
+		vkDestroyBuffer(vk->device, ini->rect_buffer, NULL);
+		return res;
+	}
+	res = vkBindBufferMemory(vk->device, ini->rect_buffer,
+			ini->rect_allocation.memory, ini->rect_allocation.offset);
+	if (res != VK_SUCCESS) {
+		memory_allocator_free(&vk->allocator, &ini->rect_allocation);
+		vkDestroyBuffer(vk->device, ini->rect_buffer, NULL);
+		return res;
+	}
+
+	/* relative to the wall, so the rects hold for any output size */
+	float (*rects)[4] = ini->rect_allocation.mapped_ptr;
+	for (uint32_t tile = 0; tile < ntiles; tile++) {
+		rects[tile][0] = (float) (tile % ini->columns) / ini->columns;
+		rects[tile][1] = (float) (tile / ini->columns) / ini->rows;
+		rects[tile][2] = 1.0f / ini->columns;
+		rects[tile][3] = 1.0f / ini->rows;
+	}
+	return VK_SUCCESS;
+}
+
+void
+wall_finish(struct wall *wall, struct vulkan_ctx *vk) {
+	vkDestroyBuffer(vk->device, wall->rect_buffer, NULL);
+	wall->rect_buffer = VK_NULL_HANDLE;
+	memory_allocator_free(&vk->allocator, &wall->rect_allocation);
+}
+
+void
+wall_size(const struct wall *wall, uint32_t tile_width, uint32_t tile_height,
+		uint32_t *width, uint32_t *height) {
+	*width = tile_width * wall->columns;
+	*height = tile_height * wall->rows;
+}
+
+bool
+wall_empty_rect(const struct wall *wall, VkRect2D viewport, VkRect2D *rect) {
+	uint32_t last_row = wall->ntiles - (wall->rows - 1) * wall->columns;
+	if (last_row == wall->columns) {
+		return false;
+	}
+
+	/* rounded down, tiles drawn over the cleared edge cover it again */
+	uint32_t x = viewport.offset.x
+		+ (uint64_t) viewport.extent.width * last_row / wall->columns;
+	uint32_t y = viewport.offset.y
+		+ (uint64_t) viewport.extent.height * (wall->rows - 1) / wall->rows;
+	*rect = (VkRect2D) {
+		.offset = { x, y },
+		.extent = {
+			.width = viewport.offset.x + viewport.extent.width - x,
+			.height = viewport.offset.y + viewport.extent.height - y,
+		},
+	};
+	return true;
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -24,7 +25,7 @@ window_create() {
 	xcb_screen_t *screen = get_screen(xcb_connection);
 
 	const uint32_t valwin[] = {
-		XCB_EVENT_MASK_STRUCTURE_NOTIFY,
+		XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_STRUCTURE_NOTIFY,
 	};
 
 	xcb_void_cookie_t cookie;
@@ -63,6 +64,9 @@ window_create() {
 	ini->window_id = wid;
 	ini->atom_delete_window = delete_reply->atom;
 	ini->close_requested = false;
+	ini->width = 640;
+	ini->height = 480;
+	ini->damaged = true;
 
 	free(protocols_reply);
 	protocols_reply = NULL;
@@ -90,12 +94,20 @@ window_poll_event(struct window *window) {
 	xcb_generic_event_t *event;
 	while ((event = xcb_poll_for_event(window->xcb_connection)) != NULL) {
 		switch (event->response_type & 0x7F) {
+			case XCB_EXPOSE:
+				window->damaged = true;
+				break;
 			case XCB_CONFIGURE_NOTIFY: {
+				/* moves and restacking are configured too, only sizes matter */
 				xcb_configure_notify_event_t *resize_event =
 					(xcb_configure_notify_event_t *) event;
-				window->width = resize_event->width;
-				window->height = resize_event->height;
-				window->resized = true;
+				if (resize_event->width != window->width
+						|| resize_event->height != window->height) {
+					window->width = resize_event->width;
+					window->height = resize_event->height;
+					window->resized = true;
+				}
+				break;
 			}
 			case XCB_CLIENT_MESSAGE: {
 				xcb_client_message_event_t *client_event =
@@ -118,3 +130,23 @@ window_poll_event(struct window *window) {
 		exit(1);
 	}
 }
+
+void
+window_wait_event(struct window *window, int timeout_ms) {
+	/* events already read off the connection would not wake poll */
+	window_poll_event(window);
+	if (window->close_requested || window->resized || window->damaged) {
+		return;
+	}
+
+	xcb_flush(window->xcb_connection);
+	struct pollfd fd = {
+		.fd = xcb_get_file_descriptor(window->xcb_connection),
+		.events = POLLIN,
+	};
+	if (poll(&fd, 1, timeout_ms) == -1) {
+		perror("window_wait_event - poll");
+	}
+
+	window_poll_event(window);
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "worker_pool.h"
+
+/* runs jobs of the current batch until none are left, called with lock held */
+static void
+run_jobs(struct worker_pool *pool) {
+	while (pool->next_job < pool->njobs) {
+		void *job = pool->jobs + pool->next_job * pool->job_size;
+		worker_pool_fn fn = pool->fn;
+		pool->next_job++;
+
+		pthread_mutex_unlock(&pool->lock);
+		fn(job);
+		pthread_mutex_lock(&pool->lock);
+
+		pool->finished_jobs++;
+		if (pool->finished_jobs == pool->njobs) {
+			pthread_cond_broadcast(&pool->done_cond);
+		}
+	}
+}
+
+static void *
+worker_main(void *data) {
+	struct worker_pool *pool = data;
+	uint64_t seen_batch = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	while (true) {
+		while (!pool->stop && pool->batch == seen_batch) {
+			pthread_cond_wait(&pool->work_cond, &pool->lock);
+		}
+		if (pool->stop) {
+			break;
+		}
+
+		seen_batch = pool->batch;
+		run_jobs(pool);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+int
+worker_pool_init(struct worker_pool *ini, uint32_t nworkers) {
+	if (nworkers < 1) {
+		nworkers = 1;
+	} else if (nworkers > WORKER_POOL_MAX_THREADS) {
+		nworkers = WORKER_POOL_MAX_THREADS;
+	}
+
+	memset(ini, 0, sizeof(struct worker_pool));
+	pthread_mutex_init(&ini->lock, NULL);
+	pthread_cond_init(&ini->work_cond, NULL);
+	pthread_cond_init(&ini->done_cond, NULL);
+
+	/* the calling thread is the first worker */
+	ini->nworkers = 1;
+	for (uint32_t i = 1; i < nworkers; i++) {
+		int err = pthread_create(&ini->threads[i], NULL, worker_main, ini);
+		if (err != 0) {
+			fprintf(stderr, "worker_pool_init - pthread_create failed: %s\n",
+					strerror(err));
+			worker_pool_finish(ini);
+			return -1;
+		}
+		ini->nworkers++;
+	}
+
+	return 0;
+}
+
+void
+worker_pool_finish(struct worker_pool *pool) {
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->work_cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (uint32_t i = 1; i < pool->nworkers; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+	pool->nworkers = 0;
+
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->work_cond);
+	pthread_mutex_destroy(&pool->lock);
+}
+
+void
+worker_pool_run(struct worker_pool *pool, worker_pool_fn fn,
+		void *jobs, size_t job_size, uint32_t njobs) {
+	if (pool->nworkers <= 1 || njobs <= 1) {
+		for (uint32_t i = 0; i < njobs; i++) {
+			fn((uint8_t *) jobs + i * job_size);
+		}
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->fn = fn;
+	pool->jobs = jobs;
+	pool->job_size = job_size;
+	pool->njobs = njobs;
+	pool->next_job = 0;
+	pool->finished_jobs = 0;
+	pool->batch++;
+	pthread_cond_broadcast(&pool->work_cond);
+
+	run_jobs(pool);
+	while (pool->finished_jobs < pool->njobs) {
+		pthread_cond_wait(&pool->done_cond, &pool->lock);
+	}
+
+	/* late workers must not pick up jobs of a finished batch */
+	pool->njobs = 0;
+	pool->next_job = 0;
+	pthread_mutex_unlock(&pool->lock);
+}